@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#include "Grid.h"
+#include "DistanceField.h"
+
+/*=============================================================================+/
+								   Collision
+/+=============================================================================*/
+
+// Pushes a circle out of every wall tile under its bounding square, without the early out.
+template <typename T>
+bool ResolveCircleTiles(const OccupancyBits& bits, T& px, T& py, T radius)
+{
+	bool touched = false;
+	for (int y = (int)std::floor(py - radius); y < py + radius; y++)
+	{
+		for (int x = (int)std::floor(px - radius); x < px + radius; x++)
+		{
+			if (!IsOccupied(bits, x, y)) continue; // not a wall, go next
+
+			T closestX = std::clamp(px, (T)x, (T)(x + 1));
+			T closestY = std::clamp(py, (T)y, (T)(y + 1));
+			T dx = px - closestX;
+			T dy = py - closestY;
+			T distance = std::sqrt(dx * dx + dy * dy);
+			if (distance >= radius || distance == (T)0) continue; // no colision
+
+			px = closestX + dx / distance * radius;
+			py = closestY + dy / distance * radius;
+			touched = true;
+		}
+	}
+	return touched;
+}
+
+// ResolveCircleTiles for a moving circle: also reflects the velocity off the direction it
+// was pushed, if it was heading into the wall.
+inline bool BounceCircle(const OccupancyBits& bits, float& px, float& py, float& vx, float& vy, float radius)
+{
+	float x = px;
+	float y = py;
+	if (!ResolveCircleTiles(bits, px, py, radius)) return false;
+
+	float nx = px - x;
+	float ny = py - y;
+	float length = std::sqrt(nx * nx + ny * ny);
+	if (length > 0.0f)
+	{
+		nx /= length;
+		ny /= length;
+		float along = vx * nx + vy * ny;
+		if (along < 0.0f)
+		{
+			vx -= 2.0f * along * nx;
+			vy -= 2.0f * along * ny;
+		}
+	}
+	return true;
+}
+
+// Pushes a circle out of every wall tile it overlaps. The distance field answers the common
+// case, nothing within reach, with a single lookup; only circles near a wall walk the tiles
+// under their bounding square. Returns true if the circle touched a wall.
+inline bool ResolveCircle(const DistanceField& field, const OccupancyBits& bits, std::array<double, 2>& pos, double radius)
+{
+	if (field.Clearance((int)std::floor(pos[0]), (int)std::floor(pos[1])) >= radius) return false;
+	return ResolveCircleTiles(bits, pos[0], pos[1], radius);
+}
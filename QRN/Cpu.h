@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <stdexcept>
+#include <intrin.h>
+
+/*=============================================================================+/
+								  CPU Features
+/+=============================================================================*/
+
+/*
+	SIMD kernels are compiled in unconditionally and picked at runtime, so one build runs on
+	anything x64 and still uses the widest vectors the machine has. An instruction set only
+	counts when the CPU has the instructions and the OS saves their registers on context
+	switches.
+	Hot kernels sit behind an IsaKernel: one function per tier (nullptr where there is none),
+	bound to the best tier at or below the active ISA. The active ISA starts as the best one
+	supported; --isa (ForceIsa) lowers it, for benchmarking the narrower paths on one box.
+*/
+
+// Tiers in order, each implying the ones before. Scalar is plain x64, which includes SSE2.
+enum class Isa : int { Scalar, Sse42, Avx2, Avx512 };
+constexpr int IsaCount = 4;
+
+inline const char* IsaName(Isa isa)
+{
+	constexpr const char* names[] = { "scalar", "sse4.2", "avx2", "avx512" };
+	return names[(int)isa];
+}
+
+inline Isa DetectIsa()
+{
+	int info[4];
+	__cpuid(info, 0);
+	int leaves = info[0];
+	__cpuid(info, 1);
+	bool sse42 = (info[2] >> 20) & 1;
+	bool osxsave = (info[2] >> 27) & 1;
+	bool avx = (info[2] >> 28) & 1;
+	if (!sse42) return Isa::Scalar;
+	if (!osxsave || !avx || leaves < 7) return Isa::Sse42;
+
+	unsigned long long xcr0 = _xgetbv(0);
+	if ((xcr0 & 0x6) != 0x6) return Isa::Sse42;               // <-- xmm and ymm state enabled
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] >> 5) & 1;
+	bool avx512f = (info[1] >> 16) & 1;
+	if (!avx2) return Isa::Sse42;
+	if (!avx512f || (xcr0 & 0xE6) != 0xE6) return Isa::Avx2;  // <-- plus opmask and zmm state
+	return Isa::Avx512;
+}
+
+inline Isa SupportedIsa()
+{
+	static const Isa isa = DetectIsa();
+	return isa;
+}
+
+inline std::atomic<int>& ActiveIsaSlot()
+{
+	static std::atomic<int> active{ (int)SupportedIsa() };
+	return active;
+}
+
+inline Isa ActiveIsa() { return (Isa)ActiveIsaSlot().load(std::memory_order_relaxed); }
+
+// Caps every kernel at isa. Asking for more than the machine has is an error, not a crash
+// later on an illegal instruction.
+inline void ForceIsa(Isa isa)
+{
+	if ((int)isa > (int)SupportedIsa())
+	{
+		throw std::runtime_error(std::string("ISA ") + IsaName(isa) + " requested, this CPU supports up to " + IsaName(SupportedIsa()));
+	}
+	ActiveIsaSlot().store((int)isa, std::memory_order_relaxed);
+}
+
+inline Isa ParseIsa(const std::string& name)
+{
+	for (int isa = 0; isa < IsaCount; isa++)
+	{
+		if (name == IsaName((Isa)isa)) return (Isa)isa;
+	}
+	throw std::runtime_error("Unknown ISA " + name + ", expected scalar, sse4.2, avx2 or avx512");
+}
+
+// Function pointer per tier for one kernel. Get is a relaxed load and a compare once bound;
+// it only searches the table again after ForceIsa changed the active tier.
+template <typename Fn>
+class IsaKernel
+{
+public:
+	// variants[i] implements tier i, nullptr where that tier has nothing of its own.
+	// The scalar entry is required.
+	explicit IsaKernel(const Fn (&table)[IsaCount])
+	{
+		for (int i = 0; i < IsaCount; i++) variants[i] = table[i];
+	}
+
+	Fn Get() const
+	{
+		int active = ActiveIsaSlot().load(std::memory_order_relaxed);
+		if (boundFor.load(std::memory_order_acquire) != active)
+		{
+			int tier = active;
+			while (tier > 0 && !variants[tier]) tier--;
+			bound.store(tier, std::memory_order_relaxed);
+			boundFor.store(active, std::memory_order_release);
+		}
+		return variants[bound.load(std::memory_order_relaxed)];
+	}
+
+	// Tier Get would run at the active ISA.
+	Isa Bound() const
+	{
+		Get();
+		return (Isa)bound.load(std::memory_order_relaxed);
+	}
+
+private:
+	Fn variants[IsaCount];
+	mutable std::atomic<int> bound{ 0 };
+	mutable std::atomic<int> boundFor{ -1 };
+};
@@ -0,0 +1,302 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <ostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "Profile.h"
+
+/*=============================================================================+/
+								  Debug Log
+/+=============================================================================*/
+
+/*
+	GL debug output without the driver callback ever touching a stream. The callback may run
+	on a driver thread, and a noisy driver can fire it thousands of times a frame, so Post
+	only does a few atomics:
+		- below the severity filter: counted, dropped
+		- message id seen before: its repeat counter goes up, nothing is queued
+		- otherwise the text is copied into a slot of a bounded lock-free queue (dropped and
+		  counted if full)
+	A background thread drains the queue, formats into a stack buffer and writes, flushing
+	once per batch. Once a second it reports repeats per id and the message rate, including
+	the busiest frame. Nothing here allocates after Start, so it stays out of the frame
+	allocation counts.
+*/
+
+constexpr int DebugLogQueueSize = 1024;        // <-- messages waiting for the writer, power of two
+constexpr int DebugLogMessageChars = 256;      // <-- longer messages are cut
+constexpr int DebugLogIds = 1024;              // <-- distinct ids tracked, power of two
+
+enum class LogSeverity : uint32_t { Notification, Low, Medium, High };
+
+inline const char* SeverityName(LogSeverity severity)
+{
+	constexpr const char* names[] = { "notification", "low", "medium", "high" };
+	return names[(uint32_t)severity];
+}
+
+struct DebugLogStats
+{
+	uint64_t posted = 0;        // <-- everything handed to Post
+	uint64_t written = 0;       // <-- first sightings that made it out
+	uint64_t repeats = 0;       // <-- folded into an earlier message with the same id
+	uint64_t filtered = 0;      // <-- below the severity filter
+	uint64_t dropped = 0;       // <-- queue full, or too many ids to track
+};
+
+class DebugLog
+{
+public:
+	std::atomic<LogSeverity> minSeverity{ LogSeverity::Low };
+
+	DebugLog()
+	{
+		for (size_t i = 0; i < DebugLogQueueSize; i++) queue[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	~DebugLog() { Stop(); }
+
+	void Start(std::ostream& stream)
+	{
+		if (writer.joinable()) return;
+		out = &stream;
+		running.store(true, std::memory_order_relaxed);
+		writer = std::thread([this] { WriterLoop(); });
+	}
+
+	// Drains what is queued, writes a last summary, joins the writer.
+	void Stop()
+	{
+		if (!writer.joinable()) return;
+		running.store(false, std::memory_order_relaxed);
+		writer.join();
+	}
+
+	// Safe from any thread, never blocks. source and type must be string literals.
+	void Post(uint32_t id, LogSeverity severity, const char* source, const char* type, const char* message, int length)
+	{
+		posted.fetch_add(1, std::memory_order_relaxed);
+		if (severity < minSeverity.load(std::memory_order_relaxed))
+		{
+			filtered.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		IdCounter* counter = Track(id);
+		if (!counter)
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (counter->seen.fetch_add(1, std::memory_order_relaxed) > 0)
+		{
+			repeats.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		// bounded MPMC queue: each slot's sequence says whose turn it is
+		size_t position = enqueuePosition.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true)
+		{
+			slot = &queue[position & (DebugLogQueueSize - 1)];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+			if (difference == 0)
+			{
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+			}
+			else if (difference < 0)
+			{
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				counter->seen.store(0, std::memory_order_relaxed); // <-- so the next one gets a chance
+				return;
+			}
+			else position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+
+		if (length < 0) length = (int)std::strlen(message);
+		slot->id = id;
+		slot->severity = severity;
+		slot->source = source;
+		slot->type = type;
+		slot->length = (std::min)(length, DebugLogMessageChars - 1);
+		std::memcpy(slot->text, message, slot->length);
+		slot->text[slot->length] = '\0';
+		slot->sequence.store(position + 1, std::memory_order_release);
+	}
+
+	// Called by the window once per frame, for the per frame rate.
+	void EndFrame()
+	{
+		uint64_t now = posted.load(std::memory_order_relaxed);
+		uint64_t frame = now - framePosted;
+		framePosted = now;
+		frames.fetch_add(1, std::memory_order_relaxed);
+		uint64_t peak = peakFrame.load(std::memory_order_relaxed);
+		while (frame > peak && !peakFrame.compare_exchange_weak(peak, frame, std::memory_order_relaxed)) {}
+	}
+
+	DebugLogStats Stats() const
+	{
+		return { posted.load(std::memory_order_relaxed), written.load(std::memory_order_relaxed),
+			repeats.load(std::memory_order_relaxed), filtered.load(std::memory_order_relaxed),
+			dropped.load(std::memory_order_relaxed) };
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		uint32_t id;
+		LogSeverity severity;
+		const char* source;
+		const char* type;
+		int length;
+		char text[DebugLogMessageChars];
+	};
+
+	struct IdCounter
+	{
+		std::atomic<uint32_t> key{ 0 };       // <-- id + 1, 0 is empty
+		std::atomic<uint64_t> seen{ 0 };
+		uint64_t reported = 0;                // <-- writer only: repeats already reported
+	};
+
+	Slot queue[DebugLogQueueSize];
+	alignas(64) std::atomic<size_t> enqueuePosition{ 0 };
+	alignas(64) size_t dequeuePosition = 0;   // <-- writer only
+	IdCounter ids[DebugLogIds];
+
+	std::atomic<uint64_t> posted{ 0 }, written{ 0 }, repeats{ 0 }, filtered{ 0 }, dropped{ 0 };
+	std::atomic<uint64_t> frames{ 0 }, peakFrame{ 0 };
+	uint64_t framePosted = 0;                 // <-- main thread only
+
+	std::ostream* out = nullptr;
+	std::atomic<bool> running{ false };
+	std::thread writer;
+
+	// Open addressing, insert only; ids are never forgotten.
+	IdCounter* Track(uint32_t id)
+	{
+		uint32_t key = id + 1;
+		uint32_t start = (key * 2654435761u) & (DebugLogIds - 1);
+		for (uint32_t probe = 0; probe < DebugLogIds; probe++)
+		{
+			IdCounter& counter = ids[(start + probe) & (DebugLogIds - 1)];
+			uint32_t current = counter.key.load(std::memory_order_acquire);
+			if (current == 0 && counter.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) return &counter;
+			if (current == key) return &counter;
+		}
+		return nullptr;
+	}
+
+	bool Pop(Slot*& slot)
+	{
+		slot = &queue[dequeuePosition & (DebugLogQueueSize - 1)];
+		return slot->sequence.load(std::memory_order_acquire) == dequeuePosition + 1;
+	}
+
+	void Release(Slot* slot)
+	{
+		slot->sequence.store(dequeuePosition + DebugLogQueueSize, std::memory_order_release);
+		dequeuePosition++;
+	}
+
+	template <typename... Args>
+	void Write(const char* format, Args... args)
+	{
+		char line[DebugLogMessageChars + 128];
+		int n = std::snprintf(line, sizeof(line), format, args...);
+		out->write(line, (std::min)(n, (int)sizeof(line) - 1));
+	}
+
+	// Drains the queue, returns whether anything was written.
+	bool Drain()
+	{
+		bool any = false;
+		Slot* slot;
+		while (Pop(slot))
+		{
+			Write("GL %s %s [%s] #%u: %s\n", slot->source, slot->type, SeverityName(slot->severity), slot->id, slot->text);
+			Release(slot);
+			written.fetch_add(1, std::memory_order_relaxed);
+			any = true;
+		}
+		return any;
+	}
+
+	void Summarize(double seconds, uint64_t& lastPosted, uint64_t& lastFrames)
+	{
+		bool any = false;
+		for (IdCounter& counter : ids)
+		{
+			if (counter.key.load(std::memory_order_acquire) == 0) continue;
+			uint64_t seen = counter.seen.load(std::memory_order_relaxed);
+			if (seen == 0) continue;
+			uint64_t repeated = seen - 1; // <-- the first one was written
+			if (repeated > counter.reported)
+			{
+				Write("GL #%u repeated %llu more times, %llu total\n", counter.key.load(std::memory_order_relaxed) - 1,
+					(unsigned long long)(repeated - counter.reported), (unsigned long long)seen);
+				any = true;
+			}
+			counter.reported = repeated;
+		}
+
+		uint64_t postedNow = posted.load(std::memory_order_relaxed);
+		uint64_t framesNow = frames.load(std::memory_order_relaxed);
+		uint64_t peak = peakFrame.exchange(0, std::memory_order_relaxed);
+		if (postedNow != lastPosted)
+		{
+			uint64_t count = postedNow - lastPosted;
+			uint64_t frameCount = framesNow - lastFrames;
+			Write("GL debug: %llu messages in %.1f s, %.1f per frame, peak %llu in one frame (%llu filtered, %llu dropped so far)\n",
+				(unsigned long long)count, seconds, frameCount ? (double)count / frameCount : 0.0, (unsigned long long)peak,
+				(unsigned long long)filtered.load(std::memory_order_relaxed), (unsigned long long)dropped.load(std::memory_order_relaxed));
+			any = true;
+		}
+		lastPosted = postedNow;
+		lastFrames = framesNow;
+		if (any) out->flush();
+	}
+
+	void WriterLoop()
+	{
+		Profile().NameThread("debug log");
+		auto lastSummary = std::chrono::steady_clock::now();
+		uint64_t lastPosted = 0, lastFrames = 0;
+		while (running.load(std::memory_order_relaxed))
+		{
+			bool wrote;
+			{
+				PROFILE_SCOPE("debug log drain");
+				wrote = Drain();
+			}
+			if (wrote) out->flush();
+
+			auto now = std::chrono::steady_clock::now();
+			double seconds = std::chrono::duration<double>(now - lastSummary).count();
+			if (seconds >= 1.0)
+			{
+				Summarize(seconds, lastPosted, lastFrames);
+				lastSummary = now;
+			}
+			if (!wrote) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		Drain();
+		Summarize(std::chrono::duration<double>(std::chrono::steady_clock::now() - lastSummary).count(), lastPosted, lastFrames);
+		out->flush();
+	}
+};
+
+// The one the GL debug callback posts to.
+inline DebugLog& GlLog()
+{
+	static DebugLog log;
+	return log;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "Grid.h"
+#include "Parallel.h"
+
+/*=============================================================================+/
+								 Distance Field
+/+=============================================================================*/
+
+/*
+	Per tile Euclidean distance from the tile's center to the nearest wall tile's center,
+	exact, via the two pass separable transform of Felzenszwalb & Huttenlocher (columns, then
+	rows, each pass parallel over lines).
+	Values are clamped to DistanceFieldMax. That makes every tile depend only on walls within
+	that range, so a change can be patched by redoing just the window around it.
+	Any point inside tile t is at least Clearance(t) away from every wall.
+*/
+
+constexpr int DistanceFieldMax = 16;                     // <-- tiles; also the reach of a local update
+constexpr float TileDiagonal = 1.41421356f;              // <-- center to corner twice over
+
+struct DistanceField
+{
+	std::vector<float> distances = std::vector<float>((size_t)MapSize * MapSize, 0.0f);
+
+	float At(int x, int y) const
+	{
+		if ((unsigned)x >= (unsigned)MapSize || (unsigned)y >= (unsigned)MapSize) return 0.0f;
+		return distances[(size_t)y * MapSize + x];
+	}
+
+	// Guaranteed free space around any point in the tile.
+	float Clearance(int x, int y) const
+	{
+		return At(x, y) - TileDiagonal;
+	}
+
+	void Generate(const OccupancyBits& bits)
+	{
+		Update(bits, 0, 0, MapSize, MapSize);
+	}
+
+	// Recomputes tiles in [x0, x1) x [y0, y1) after walls in that rectangle changed. Works on
+	// the rectangle padded by DistanceFieldMax so every wall that can matter is seen, with
+	// anything off the map counting as a wall like IsOccupied does.
+	void Update(const OccupancyBits& bits, int x0, int y0, int x1, int y1)
+	{
+		x0 = (std::max)(x0 - DistanceFieldMax, 0);
+		y0 = (std::max)(y0 - DistanceFieldMax, 0);
+		x1 = (std::min)(x1 + DistanceFieldMax, MapSize);
+		y1 = (std::min)(y1 + DistanceFieldMax, MapSize);
+		int px0 = x0 - DistanceFieldMax;
+		int py0 = y0 - DistanceFieldMax;
+		int width = x1 - x0 + 2 * DistanceFieldMax;
+		int height = y1 - y0 + 2 * DistanceFieldMax;
+
+		constexpr double noWall = 1e12; // <-- "no wall yet", big but finite so the parabola math stays exact
+		std::vector<double> squared((size_t)width * height);
+
+		// columns: squared vertical distance to the nearest wall in the same column
+		ParallelFor(0, width, [&](int column)
+		{
+			thread_local std::vector<double> f, d, z;
+			thread_local std::vector<int> v;
+			f.resize(height);
+			for (int row = 0; row < height; row++)
+			{
+				f[row] = IsOccupied(bits, px0 + column, py0 + row) ? 0.0 : noWall;
+			}
+			Transform1D(f, d, v, z);
+			for (int row = 0; row < height; row++) squared[(size_t)row * width + column] = d[row];
+		});
+
+		// rows: combine into the full 2D squared distance, keep only the inner rectangle
+		ParallelFor(y0 - py0, y1 - py0, [&](int row)
+		{
+			thread_local std::vector<double> f, d, z;
+			thread_local std::vector<int> v;
+			f.assign(squared.begin() + (size_t)row * width, squared.begin() + (size_t)(row + 1) * width);
+			Transform1D(f, d, v, z);
+			float* out = distances.data() + (size_t)(py0 + row) * MapSize;
+			for (int x = x0; x < x1; x++)
+			{
+				out[x] = (float)(std::min)(std::sqrt(d[x - px0]), (double)DistanceFieldMax);
+			}
+		});
+	}
+
+	// 1D squared distance transform of sampled function f (lower envelope of parabolas).
+	static void Transform1D(const std::vector<double>& f, std::vector<double>& d, std::vector<int>& v, std::vector<double>& z)
+	{
+		int n = (int)f.size();
+		d.resize(n);
+		v.resize(n);
+		z.resize(n + 1);
+
+		int k = 0;
+		v[0] = 0;
+		z[0] = -INFINITY;
+		z[1] = INFINITY;
+		auto intersect = [&](int q, int p)
+		{
+			return ((f[q] + (double)q * q) - (f[p] + (double)p * p)) / (2.0 * (q - p));
+		};
+		for (int q = 1; q < n; q++)
+		{
+			double s = intersect(q, v[k]);
+			while (s <= z[k]) // <-- z[0] is -inf, so this always stops by k == 0
+			{
+				k--;
+				s = intersect(q, v[k]);
+			}
+			k++;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = INFINITY;
+		}
+
+		k = 0;
+		for (int q = 0; q < n; q++)
+		{
+			while (z[k + 1] < q) k++;
+			double offset = (double)(q - v[k]);
+			d[q] = offset * offset + f[v[k]];
+		}
+	}
+};
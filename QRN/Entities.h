@@ -0,0 +1,300 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <bit>
+#include <span>
+#include <immintrin.h>
+
+#include "Grid.h"
+#include "Hash.h"
+#include "DistanceField.h"
+#include "Collision.h"
+#include "FrameMemory.h"
+#include "Parallel.h"
+#include "Cpu.h"
+
+/*=============================================================================+/
+									Entities
+/+=============================================================================*/
+
+/*
+	Circles moving over the tile map, stored structure of arrays so each tick phase streams
+	through only the fields it needs:
+		1. counting sort into a uniform grid of one tile cells (radius <= 0.5, so every
+		   contact is between neighbouring cells)
+		2. each entity sums its own push out of its neighbours, then all pushes are applied,
+		   so no two threads ever write the same entity
+		3. integrate and resolve against walls, 4 entities per SSE step or 8 per AVX2 step
+		   (picked at runtime, Cpu.h); the distance field clears whole groups at once and
+		   only lanes near a wall take the scalar tile walk
+	Phases 2 and 3 run in blocks across ParallelFor.
+*/
+
+constexpr float EntityMaxRadius = 0.5f;
+constexpr int EntityBlock = 1024;            // <-- entities per parallel task
+
+struct EntitySystem
+{
+	std::vector<float> posX, posY;
+	std::vector<float> velX, velY;
+	std::vector<float> radius;
+
+	// broadphase, rebuilt every tick
+	std::vector<uint32_t> cellStart;         // <-- MapSize^2 + 1 prefix offsets into cellEntities
+	std::vector<uint32_t> cellEntities;      // <-- entity indices grouped by cell
+	std::vector<uint32_t> entityCell;
+
+	std::vector<float> pushX, pushY;         // <-- per entity separation, applied after the contact pass
+
+	// stats from the last Step
+	int wallContacts = 0;
+	int entityContacts = 0;
+
+	int Count() const { return (int)posX.size(); }
+
+	int Spawn(float x, float y, float vx, float vy, float r)
+	{
+		posX.push_back(x);
+		posY.push_back(y);
+		velX.push_back(vx);
+		velY.push_back(vy);
+		radius.push_back((std::min)(r, EntityMaxRadius));
+		return Count() - 1;
+	}
+
+	void Clear()
+	{
+		posX.clear(); posY.clear(); velX.clear(); velY.clear(); radius.clear();
+	}
+
+	void Step(float dt, const DistanceField& field, const OccupancyBits& bits)
+	{
+		int count = Count();
+		if (count == 0) return;
+		int blocks = (count + EntityBlock - 1) / EntityBlock;
+		ArenaScope scope;
+		std::span<int> wallHits = FrameMemory().Array<int>(blocks);
+		std::span<int> pairHits = FrameMemory().Array<int>(blocks);
+
+		BuildGrid();
+
+		pushX.assign(count, 0.0f);
+		pushY.assign(count, 0.0f);
+		ParallelFor(0, blocks, [&](int block)
+		{
+			int begin = block * EntityBlock;
+			pairHits[block] = SeparateBlock(begin, (std::min)(begin + EntityBlock, count));
+		});
+		// a crowd can shove someone hard enough to put their center inside a wall, where the
+		// tile walk can't recover them; drop any axis of the push that would
+		for (int i = 0; i < count; i++)
+		{
+			float x = posX[i] + pushX[i];
+			float y = posY[i] + pushY[i];
+			if (!IsOccupied(bits, (int)std::floor(x), (int)std::floor(posY[i]))) posX[i] = x;
+			if (!IsOccupied(bits, (int)std::floor(posX[i]), (int)std::floor(y))) posY[i] = y;
+		}
+
+		// walls last, so a push from a neighbour can never leave anyone inside one
+		MoveFn move = MoveKernel().Get();
+		ParallelFor(0, blocks, [&](int block)
+		{
+			int begin = block * EntityBlock;
+			wallHits[block] = (this->*move)(begin, (std::min)(begin + EntityBlock, count), dt, field, bits);
+		});
+
+		wallContacts = 0;
+		entityContacts = 0;
+		for (int block = 0; block < blocks; block++)
+		{
+			wallContacts += wallHits[block];
+			entityContacts += pairHits[block];
+		}
+		entityContacts /= 2; // <-- both sides of every pair counted it
+	}
+
+	// Integrates [begin, end) and resolves it against walls. Returns wall contacts.
+	int MoveBlock(int begin, int end, float dt, const DistanceField& field, const OccupancyBits& bits)
+	{
+		int contacts = 0;
+		const __m128 step = _mm_set1_ps(dt);
+		const __m128 lowest = _mm_setzero_ps();
+		const __m128 highest = _mm_set1_ps((float)MapSize - 1.0f);
+		const float* distances = field.distances.data();
+
+		int i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 x = _mm_add_ps(_mm_loadu_ps(&posX[i]), _mm_mul_ps(_mm_loadu_ps(&velX[i]), step));
+			__m128 y = _mm_add_ps(_mm_loadu_ps(&posY[i]), _mm_mul_ps(_mm_loadu_ps(&velY[i]), step));
+			_mm_storeu_ps(&posX[i], x);
+			_mm_storeu_ps(&posY[i], y);
+
+			// tile index per lane, then a gathered clearance test for all four at once
+			__m128i tx = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(x, lowest), highest));
+			__m128i ty = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(y, lowest), highest));
+			alignas(16) int32_t cellX[4], cellY[4];
+			_mm_store_si128((__m128i*)cellX, tx);
+			_mm_store_si128((__m128i*)cellY, ty);
+			__m128 clearance = _mm_sub_ps(_mm_setr_ps(
+				distances[cellY[0] * MapSize + cellX[0]],
+				distances[cellY[1] * MapSize + cellX[1]],
+				distances[cellY[2] * MapSize + cellX[2]],
+				distances[cellY[3] * MapSize + cellX[3]]), _mm_set1_ps(TileDiagonal));
+			int nearWall = _mm_movemask_ps(_mm_cmplt_ps(clearance, _mm_loadu_ps(&radius[i])));
+
+			while (nearWall)
+			{
+				int lane = std::countr_zero((unsigned)nearWall);
+				nearWall &= nearWall - 1;
+				contacts += ResolveWall(i + lane, bits);
+			}
+		}
+		for (; i < end; i++)
+		{
+			posX[i] += velX[i] * dt;
+			posY[i] += velY[i] * dt;
+			if (field.Clearance((int)posX[i], (int)posY[i]) < radius[i]) contacts += ResolveWall(i, bits);
+		}
+		return contacts;
+	}
+
+	// MoveBlock eight wide, with the clearances gathered; same arithmetic, so same results.
+	int MoveBlockAvx2(int begin, int end, float dt, const DistanceField& field, const OccupancyBits& bits)
+	{
+		int contacts = 0;
+		const __m256 step = _mm256_set1_ps(dt);
+		const __m256 lowest = _mm256_setzero_ps();
+		const __m256 highest = _mm256_set1_ps((float)MapSize - 1.0f);
+		const __m256 diagonal = _mm256_set1_ps(TileDiagonal);
+		const __m256i rowStride = _mm256_set1_epi32(MapSize);
+		const float* distances = field.distances.data();
+
+		int i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 x = _mm256_add_ps(_mm256_loadu_ps(&posX[i]), _mm256_mul_ps(_mm256_loadu_ps(&velX[i]), step));
+			__m256 y = _mm256_add_ps(_mm256_loadu_ps(&posY[i]), _mm256_mul_ps(_mm256_loadu_ps(&velY[i]), step));
+			_mm256_storeu_ps(&posX[i], x);
+			_mm256_storeu_ps(&posY[i], y);
+
+			__m256i tx = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(x, lowest), highest));
+			__m256i ty = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(y, lowest), highest));
+			__m256i cell = _mm256_add_epi32(_mm256_mullo_epi32(ty, rowStride), tx);
+			__m256 clearance = _mm256_sub_ps(_mm256_i32gather_ps(distances, cell, 4), diagonal);
+			int nearWall = _mm256_movemask_ps(_mm256_cmp_ps(clearance, _mm256_loadu_ps(&radius[i]), _CMP_LT_OQ));
+
+			while (nearWall)
+			{
+				int lane = std::countr_zero((unsigned)nearWall);
+				nearWall &= nearWall - 1;
+				contacts += ResolveWall(i + lane, bits);
+			}
+		}
+		return contacts + MoveBlock(i, end, dt, field, bits); // <-- SSE and scalar for the rest
+	}
+
+	using MoveFn = int (EntitySystem::*)(int, int, float, const DistanceField&, const OccupancyBits&);
+	static const IsaKernel<MoveFn>& MoveKernel()
+	{
+		static const IsaKernel<MoveFn> kernel({ &EntitySystem::MoveBlock, nullptr, &EntitySystem::MoveBlockAvx2, nullptr });
+		return kernel;
+	}
+
+	// Scalar tile walk for one entity near a wall.
+	int ResolveWall(int i, const OccupancyBits& bits)
+	{
+		return BounceCircle(bits, posX[i], posY[i], velX[i], velY[i], radius[i]);
+	}
+
+	int CellOf(int i) const
+	{
+		int x = std::clamp((int)posX[i], 0, MapSize - 1);
+		int y = std::clamp((int)posY[i], 0, MapSize - 1);
+		return y * MapSize + x;
+	}
+
+	void BuildGrid()
+	{
+		int count = Count();
+		cellStart.assign((size_t)MapSize * MapSize + 1, 0);
+		entityCell.resize(count);
+		cellEntities.resize(count);
+
+		for (int i = 0; i < count; i++)
+		{
+			entityCell[i] = (uint32_t)CellOf(i);
+			cellStart[entityCell[i] + 1]++;
+		}
+		for (size_t c = 1; c < cellStart.size(); c++) cellStart[c] += cellStart[c - 1];
+		// scatter using cellStart[c] as a cursor, then shift it back to the cell's start
+		for (int i = 0; i < count; i++) cellEntities[cellStart[entityCell[i]]++] = (uint32_t)i;
+		for (size_t c = cellStart.size() - 1; c > 0; c--) cellStart[c] = cellStart[c - 1];
+		cellStart[0] = 0;
+	}
+
+	// Sums the separation of every entity in [begin, end) from overlapping neighbours.
+	int SeparateBlock(int begin, int end)
+	{
+		int contacts = 0;
+		for (int i = begin; i < end; i++)
+		{
+			int cell = (int)entityCell[i];
+			int cx = cell % MapSize;
+			int cy = cell / MapSize;
+			float px = 0.0f;
+			float py = 0.0f;
+			for (int y = (std::max)(cy - 1, 0); y <= (std::min)(cy + 1, MapSize - 1); y++)
+			{
+				for (int x = (std::max)(cx - 1, 0); x <= (std::min)(cx + 1, MapSize - 1); x++)
+				{
+					int neighbour = y * MapSize + x;
+					for (uint32_t k = cellStart[neighbour]; k < cellStart[neighbour + 1]; k++)
+					{
+						uint32_t j = cellEntities[k];
+						if (j == (uint32_t)i) continue;
+						float dx = posX[i] - posX[j];
+						float dy = posY[i] - posY[j];
+						float reach = radius[i] + radius[j];
+						float dist2 = dx * dx + dy * dy;
+						if (dist2 >= reach * reach) continue;
+
+						float dist = std::sqrt(dist2);
+						float overlap = 0.5f * (reach - dist); // <-- each side moves half
+						if (dist > 0.0f)
+						{
+							px += dx / dist * overlap;
+							py += dy / dist * overlap;
+						}
+						else
+						{
+							px += (i < (int)j ? overlap : -overlap); // <-- exactly stacked, split along x
+						}
+						contacts++;
+					}
+				}
+			}
+			pushX[i] = px;
+			pushY[i] = py;
+		}
+		return contacts;
+	}
+};
+
+// Fills the system with count entities on random open tiles, heading in random directions.
+inline void SpawnRandomEntities(EntitySystem& entities, const OccupancyBits& bits, int count, uint32_t seed)
+{
+	for (uint32_t attempt = 0; entities.Count() < count && attempt < (uint32_t)count * 16u; attempt++)
+	{
+		uint32_t h = ChaoticHash(seed + attempt * 0x9E3779B9u);
+		float x = UintToUnit(h) * (float)MapSize;
+		float y = UintToUnit(ChaoticHash(h)) * (float)MapSize;
+		if (IsOccupied(bits, (int)x, (int)y)) continue;
+		float angle = UintToUnit(ChaoticHash(h ^ 0x5bd1e995u)) * 6.2831853f;
+		float speed = 1.0f + 3.0f * UintToUnit(ChaoticHash(h + 1u));
+		ResolveCircleTiles(bits, x, y, 0.3f);
+		entities.Spawn(x, y, std::cos(angle) * speed, std::sin(angle) * speed, 0.3f);
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+/*=============================================================================+/
+									 Epochs
+/+=============================================================================*/
+
+/*
+	Epoch based reclamation, for data structures whose readers take no locks. A reader pins
+	its thread for as long as it holds pointers into the structure; a writer that unlinks
+	something retires it at the current epoch and moves the epoch on, and may free it once
+	every pinned thread pinned at a later epoch. Readers never wait on writers and writers
+	never wait on readers: a long read only delays when memory comes back.
+	Pinning is two atomic stores and a load, and nests. Every thread that ever pins gets a
+	slot for the life of the process, like a profiler ring; an exited thread's slot stays
+	idle and holds nothing back.
+*/
+
+class EpochDomain
+{
+public:
+	static constexpr uint64_t Idle = (std::numeric_limits<uint64_t>::max)();
+
+	void Enter()
+	{
+		Slot& slot = ThreadSlot();
+		if (slot.depth++ > 0) return; // <-- already pinned further out, keep the older epoch
+		slot.pinned.store(epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+	}
+
+	void Exit()
+	{
+		Slot& slot = ThreadSlot();
+		if (--slot.depth > 0) return;
+		slot.pinned.store(Idle, std::memory_order_release);
+	}
+
+	// Call after unlinking something; it is safe to free once OldestPinned() is past the
+	// epoch returned.
+	uint64_t Retire() { return epoch.fetch_add(1, std::memory_order_seq_cst); }
+
+	// The earliest epoch any thread is pinned at, Idle when none is.
+	uint64_t OldestPinned() const
+	{
+		uint64_t oldest = Idle;
+		for (const Slot* slot = slots.load(std::memory_order_acquire); slot; slot = slot->next)
+		{
+			uint64_t pinned = slot->pinned.load(std::memory_order_seq_cst);
+			if (pinned < oldest) oldest = pinned;
+		}
+		return oldest;
+	}
+
+	// Threads currently pinned, for stats.
+	int Pinned() const
+	{
+		int count = 0;
+		for (const Slot* slot = slots.load(std::memory_order_acquire); slot; slot = slot->next)
+			count += slot->pinned.load(std::memory_order_relaxed) != Idle;
+		return count;
+	}
+
+private:
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t> pinned{ Idle };
+		int depth = 0;                  // <-- owning thread only
+		Slot* next = nullptr;           // <-- registry list, never unlinked
+	};
+
+	std::atomic<uint64_t> epoch{ 1 };
+	std::atomic<Slot*> slots{ nullptr };
+
+	Slot& ThreadSlot()
+	{
+		thread_local Slot* slot = nullptr;
+		if (!slot)
+		{
+			slot = new Slot();
+			Slot* head = slots.load(std::memory_order_relaxed);
+			do slot->next = head;
+			while (!slots.compare_exchange_weak(head, slot, std::memory_order_release, std::memory_order_relaxed));
+		}
+		return *slot;
+	}
+};
+
+// The domain every lock-free reader shares.
+inline EpochDomain& Epochs()
+{
+	static EpochDomain domain;
+	return domain;
+}
+
+// Pins the calling thread for its lifetime.
+struct EpochPin
+{
+	EpochPin() { Epochs().Enter(); }
+	~EpochPin() { Epochs().Exit(); }
+	EpochPin(const EpochPin&) = delete;
+	EpochPin& operator=(const EpochPin&) = delete;
+};
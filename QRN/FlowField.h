@@ -0,0 +1,371 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "Grid.h"
+#include "Parallel.h"
+#include "Pathfinding.h"
+#include "Entities.h"
+
+/*=============================================================================+/
+								   Flow Fields
+/+=============================================================================*/
+
+/*
+	Shortest path cost from every tile to one goal tile, with the same moves and costs as
+	FindPath, plus the first step to take from each tile. Agents sharing the goal just read
+	their tile's direction.
+	Costs are settled by label correcting over 32x32 blocks: a block runs Dijkstra inside
+	itself from whatever its border offers, and the neighbours of every block it changed are
+	queued again. Blocks run in
+	parallel one colour of a 2x2 checkerboard at a time, so no block is read while written.
+	Because settling only ever lowers costs, moving the goal reuses the old field: shifting
+	every cost up by the old distance to the new goal leaves a valid upper bound that is
+	already settled everywhere except at the new goal, and only the tiles that get closer
+	are revisited.
+*/
+
+constexpr int FlowBlockSize = 32;
+constexpr int FlowBlocks = MapSize / FlowBlockSize;   // <-- per side
+constexpr uint8_t FlowNone = PathDirections;           // <-- goal or unreachable
+constexpr float FlowRetargetRange = 16.0f;             // <-- reuse a cached field when its goal is at most this far away
+constexpr int FlowCacheSize = 8;
+constexpr float FlowBucketWidth = 64.0f;              // <-- cost window of blocks settled together
+
+struct FlowField
+{
+	int goalX = -1, goalY = -1;
+	std::vector<float> cost = std::vector<float>((size_t)MapSize * MapSize, INFINITY);
+	std::vector<uint8_t> direction = std::vector<uint8_t>((size_t)MapSize * MapSize, FlowNone);
+	uint64_t lastUsed = 0;
+
+	// Unit direction of the first step toward the goal from the tile under (x, y), zero at
+	// the goal, in walls and where the goal can't be reached.
+	std::array<float, 2> Sample(float x, float y) const
+	{
+		constexpr float d = 0.70710678f;
+		static constexpr float unit[PathDirections + 1][2] = {
+			{ 0, -1 }, { d, -d }, { 1, 0 }, { d, d }, { 0, 1 }, { -d, d }, { -1, 0 }, { -d, -d }, { 0, 0 }
+		};
+		int tx = (int)std::floor(x);
+		int ty = (int)std::floor(y);
+		if ((unsigned)tx >= (unsigned)MapSize || (unsigned)ty >= (unsigned)MapSize) return { 0.0f, 0.0f };
+		const float* step = unit[direction[(size_t)ty * MapSize + tx]];
+		return { step[0], step[1] };
+	}
+};
+
+struct FlowFieldCache
+{
+	std::vector<uint8_t> moves = std::vector<uint8_t>((size_t)MapSize * MapSize, 0); // <-- bit k set if PathStep[k] is allowed
+	std::vector<FlowField> fields;
+	uint64_t clock = 0;
+
+	// stats
+	int hits = 0;
+	int generated = 0;
+	int retargeted = 0;
+	int blocksSettled = 0;       // <-- block sweeps done by the last build
+
+	// Takes the map and drops every cached field.
+	void Reset(const OccupancyBits& bits)
+	{
+		Update(bits, 0, 0, MapSize, MapSize);
+		hits = generated = retargeted = 0;
+	}
+
+	// After tiles in [x0, x1) x [y0, y1) changed: a tile's moves read its neighbours, so the
+	// rectangle padded by one is redone. Any cached field may route through the change, so
+	// they all go.
+	void Update(const OccupancyBits& bits, int x0, int y0, int x1, int y1)
+	{
+		x0 = (std::max)(x0 - 1, 0);
+		y0 = (std::max)(y0 - 1, 0);
+		x1 = (std::min)(x1 + 1, MapSize);
+		y1 = (std::min)(y1 + 1, MapSize);
+		ParallelFor(y0, y1, [&](int y)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				uint8_t mask = 0;
+				if (!IsOccupied(bits, x, y))
+					for (int k = 0; k < PathDirections; k++)
+						if (JumpTable::CanStep(bits, x, y, k)) mask |= (uint8_t)(1u << k);
+				moves[(size_t)y * MapSize + x] = mask;
+			}
+		});
+		fields.clear();
+	}
+
+	// Field toward (goalX, goalY): from the cache, retargeted from a cached field with a goal
+	// close by, or generated from scratch.
+	const FlowField& Toward(int goalX, int goalY)
+	{
+		clock++;
+		size_t goal = (size_t)goalY * MapSize + goalX;
+		for (FlowField& field : fields)
+		{
+			if (field.goalX == goalX && field.goalY == goalY)
+			{
+				field.lastUsed = clock;
+				hits++;
+				return field;
+			}
+		}
+
+		// nearest cached goal by path cost, which the old field already knows
+		int source = -1;
+		for (int i = 0; i < (int)fields.size(); i++)
+		{
+			float distance = fields[i].cost[goal];
+			if (distance <= FlowRetargetRange && (source < 0 || distance < fields[source].cost[goal])) source = i;
+		}
+
+		int slot;
+		if ((int)fields.size() < FlowCacheSize)
+		{
+			slot = (int)fields.size();
+			fields.emplace_back();
+		}
+		else
+		{
+			slot = 0;
+			for (int i = 1; i < (int)fields.size(); i++)
+				if (fields[i].lastUsed < fields[slot].lastUsed) slot = i;
+		}
+		FlowField& field = fields[slot];
+		if (source >= 0)
+		{
+			if (source != slot)
+			{
+				field.cost = fields[source].cost;
+				field.direction = fields[source].direction;
+			}
+			Retarget(field, goalX, goalY);
+			retargeted++;
+		}
+		else
+		{
+			Generate(field, goalX, goalY);
+			generated++;
+		}
+		field.lastUsed = clock;
+		return field;
+	}
+
+	void Generate(FlowField& field, int goalX, int goalY)
+	{
+		std::fill(field.cost.begin(), field.cost.end(), INFINITY);
+		field.goalX = goalX;
+		field.goalY = goalY;
+		Settle(field);
+		ParallelFor(0, FlowBlocks * FlowBlocks, [&](int block) { Directions(field, block); });
+	}
+
+	// Moves an already settled field to a new goal, revisiting only tiles that get closer.
+	void Retarget(FlowField& field, int goalX, int goalY)
+	{
+		float shift = field.cost[(size_t)goalY * MapSize + goalX];
+		ParallelFor(0, MapSize, [&](int y)
+		{
+			float* row = field.cost.data() + (size_t)y * MapSize;
+			for (int x = 0; x < MapSize; x++) row[x] += shift; // <-- infinity stays infinity
+		});
+		field.goalX = goalX;
+		field.goalY = goalY;
+
+		// a tile's direction reads its neighbours, so redo every block next to one that changed
+		std::vector<uint8_t> touched = Settle(field);
+		std::vector<int> redo;
+		for (int block = 0; block < FlowBlocks * FlowBlocks; block++)
+		{
+			int bx = block % FlowBlocks;
+			int by = block / FlowBlocks;
+			bool nextToTouched = false;
+			for (int y = (std::max)(by - 1, 0); y <= (std::min)(by + 1, FlowBlocks - 1) && !nextToTouched; y++)
+				for (int x = (std::max)(bx - 1, 0); x <= (std::min)(bx + 1, FlowBlocks - 1) && !nextToTouched; x++)
+					nextToTouched = touched[y * FlowBlocks + x];
+			if (nextToTouched) redo.push_back(block);
+		}
+		ParallelFor(0, (int)redo.size(), [&](int i) { Directions(field, redo[i]); });
+	}
+
+	// Puts the goal at zero and relaxes until nothing improves. Returns which blocks changed.
+	// Queued blocks are keyed by the cheapest cost that reached them and only those within
+	// FlowBucketWidth of the cheapest key run, so blocks settle roughly in distance order
+	// instead of being redone every time the front passes near them.
+	std::vector<uint8_t> Settle(FlowField& field)
+	{
+		std::vector<float> key(FlowBlocks * FlowBlocks, INFINITY); // <-- infinity: not queued
+		std::vector<float> lowest(FlowBlocks * FlowBlocks, INFINITY);
+		std::vector<uint8_t> touched(FlowBlocks * FlowBlocks, 0);
+		size_t goal = (size_t)field.goalY * MapSize + field.goalX;
+		blocksSettled = 0;
+
+		field.cost[goal] = 0.0f;
+		int goalBlock = (field.goalY / FlowBlockSize) * FlowBlocks + field.goalX / FlowBlockSize;
+		key[goalBlock] = 0.0f;
+		touched[goalBlock] = 1;
+		bool goalSeeded = false;
+
+		std::vector<int> batch;
+		while (true)
+		{
+			float threshold = *std::min_element(key.begin(), key.end()) + FlowBucketWidth;
+			if (threshold == INFINITY) break;
+			for (int colour = 0; colour < 4; colour++)
+			{
+				batch.clear();
+				for (int block = 0; block < FlowBlocks * FlowBlocks; block++)
+				{
+					int bx = block % FlowBlocks;
+					int by = block / FlowBlocks;
+					if (key[block] <= threshold && (bx & 1) + 2 * (by & 1) == colour) batch.push_back(block);
+				}
+				if (batch.empty()) continue;
+				blocksSettled += (int)batch.size();
+
+				ParallelFor(0, (int)batch.size(), [&](int i) { lowest[batch[i]] = RelaxBlock(field, batch[i], batch[i] == goalBlock && !goalSeeded); });
+				for (int block : batch)
+				{
+					goalSeeded |= block == goalBlock;
+					key[block] = INFINITY;
+					if (lowest[block] == INFINITY) continue;
+					touched[block] = 1;
+					int bx = block % FlowBlocks;
+					int by = block / FlowBlocks;
+					for (int y = (std::max)(by - 1, 0); y <= (std::min)(by + 1, FlowBlocks - 1); y++)
+						for (int x = (std::max)(bx - 1, 0); x <= (std::min)(bx + 1, FlowBlocks - 1); x++)
+							if (x != bx || y != by) key[y * FlowBlocks + x] = (std::min)(key[y * FlowBlocks + x], lowest[block]);
+				}
+			}
+		}
+		return touched;
+	}
+
+	// Dijkstra confined to one block. Costs inside a block are always consistent with each
+	// other once it has run, so only edge tiles that a neighbour now offers something better
+	// (and the goal, the first time) need to start it. Returns the lowest cost that changed, infinity if none did.
+	float RelaxBlock(FlowField& field, int block, bool seedGoal) const
+	{
+		int x0 = (block % FlowBlocks) * FlowBlockSize;
+		int y0 = (block / FlowBlocks) * FlowBlockSize;
+		float* cost = field.cost.data();
+		auto inside = [&](int x, int y) { return x >= x0 && x < x0 + FlowBlockSize && y >= y0 && y < y0 + FlowBlockSize; };
+		auto heapOrder = [](const auto& a, const auto& b) { return a.first > b.first; };
+		thread_local std::vector<std::pair<float, int32_t>> open;
+		open.clear();
+
+		float changed = INFINITY;
+		if (seedGoal)
+		{
+			size_t goal = (size_t)field.goalY * MapSize + field.goalX;
+			open.push_back({ 0.0f, (int32_t)goal });
+			changed = 0.0f;
+		}
+		for (int y = y0; y < y0 + FlowBlockSize; y++)
+		{
+			bool edgeRow = y == y0 || y == y0 + FlowBlockSize - 1;
+			for (int x = x0; x < x0 + FlowBlockSize; x += (edgeRow ? 1 : FlowBlockSize - 1))
+			{
+				size_t tile = (size_t)y * MapSize + x;
+				uint8_t mask = moves[tile];
+				float best = cost[tile];
+				for (int k = 0; k < PathDirections; k++)
+				{
+					if (!(mask & (1u << k)) || inside(x + PathStep[k][0], y + PathStep[k][1])) continue;
+					float through = cost[tile + (ptrdiff_t)PathStep[k][1] * MapSize + PathStep[k][0]] + ((k & 1) ? PathDiagonalCost : 1.0f);
+					if (through < best - 1e-4f) best = through; // <-- tolerance so rounding can't keep blocks busy
+				}
+				if (best < cost[tile])
+				{
+					cost[tile] = best;
+					changed = (std::min)(changed, best);
+					open.push_back({ best, (int32_t)tile });
+				}
+			}
+		}
+		std::make_heap(open.begin(), open.end(), heapOrder);
+
+		while (!open.empty())
+		{
+			std::pop_heap(open.begin(), open.end(), heapOrder);
+			auto [at, tile] = open.back();
+			open.pop_back();
+			if (at > cost[tile]) continue;
+			int x = tile % MapSize;
+			int y = tile / MapSize;
+			uint8_t mask = moves[tile];
+			for (int k = 0; k < PathDirections; k++)
+			{
+				int nx = x + PathStep[k][0];
+				int ny = y + PathStep[k][1];
+				if (!(mask & (1u << k)) || !inside(nx, ny)) continue;
+				size_t next = (size_t)ny * MapSize + nx;
+				float through = at + ((k & 1) ? PathDiagonalCost : 1.0f);
+				if (through < cost[next] - 1e-4f)
+				{
+					cost[next] = through;
+					changed = (std::min)(changed, through);
+					open.push_back({ through, (int32_t)next });
+					std::push_heap(open.begin(), open.end(), heapOrder);
+				}
+			}
+		}
+		return changed;
+	}
+
+	// Steepest step for every tile in one block.
+	void Directions(FlowField& field, int block) const
+	{
+		int x0 = (block % FlowBlocks) * FlowBlockSize;
+		int y0 = (block / FlowBlocks) * FlowBlockSize;
+		size_t goal = (size_t)field.goalY * MapSize + field.goalX;
+		for (int y = y0; y < y0 + FlowBlockSize; y++)
+		{
+			for (int x = x0; x < x0 + FlowBlockSize; x++)
+			{
+				size_t tile = (size_t)y * MapSize + x;
+				uint8_t mask = moves[tile];
+				uint8_t best = FlowNone;
+				float bestCost = field.cost[tile];
+				if (tile != goal && bestCost < INFINITY)
+				{
+					for (int k = 0; k < PathDirections; k++)
+					{
+						if (!(mask & (1u << k))) continue;
+						float through = field.cost[tile + (ptrdiff_t)PathStep[k][1] * MapSize + PathStep[k][0]] + ((k & 1) ? PathDiagonalCost : 1.0f);
+						if (through < bestCost + 1e-3f && (best == FlowNone || through < bestCost))
+						{
+							best = (uint8_t)k;
+							bestCost = through;
+						}
+					}
+				}
+				field.direction[tile] = best;
+			}
+		}
+	}
+};
+
+// Turns every entity toward the field's direction at its tile, reaching speed over about
+// 1 / rate seconds. Entities at the goal or cut off from it keep their velocity.
+inline void SteerEntities(EntitySystem& entities, const FlowField& field, float speed, float rate, float dt)
+{
+	float blend = (std::min)(1.0f, rate * dt);
+	int count = entities.Count();
+	ParallelFor(0, (count + EntityBlock - 1) / EntityBlock, [&](int block)
+	{
+		int end = (std::min)((block + 1) * EntityBlock, count);
+		for (int i = block * EntityBlock; i < end; i++)
+		{
+			auto [dx, dy] = field.Sample(entities.posX[i], entities.posY[i]);
+			if (dx == 0.0f && dy == 0.0f) continue;
+			entities.velX[i] += (dx * speed - entities.velX[i]) * blend;
+			entities.velY[i] += (dy * speed - entities.velY[i]) * blend;
+		}
+	});
+}
@@ -0,0 +1,184 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <algorithm>
+
+/*=============================================================================+/
+								 Frame Memory
+/+=============================================================================*/
+
+/*
+	Two halves of keeping the frame loop off the heap:
+		1. FrameArena, a linear allocator for data that lives no longer than a frame. Any
+		   thread may allocate (one atomic add); the window resets it after every frame.
+		   If a frame outgrows it, the extra comes from the heap and the next Reset grows
+		   the block to the high water mark, so steady state never touches the heap.
+		2. heap counters bumped by the global operator new / delete replacements in
+		   QRN.cpp. The window diffs them per frame; once past warm up, any frame that
+		   allocates is reported, or thrown on with --strict-alloc.
+	The counters are per thread and the window reads the main thread's, so job workers,
+	the log writer and benchmark threads neither count against a frame nor hide in one.
+*/
+
+constexpr size_t FrameArenaCapacity = 8u << 20;   // <-- initial block, grows to the high water mark
+
+// The calling thread's heap counters, constant initialized so operator new can use them
+// before main.
+inline thread_local uint64_t heapAllocations = 0;
+inline thread_local uint64_t heapAllocatedBytes = 0;
+inline thread_local uint64_t heapFrees = 0;
+
+// Traffic inside an AllocationExemption on this thread, taken back out of what frames see.
+inline thread_local uint64_t exemptAllocations = 0;
+inline thread_local uint64_t exemptBytes = 0;
+inline thread_local uint64_t exemptFrees = 0;
+
+inline void CountAllocation(size_t bytes)
+{
+	heapAllocations++;
+	heapAllocatedBytes += bytes;
+}
+
+inline void CountFree()
+{
+	heapFrees++;
+}
+
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t capacity = FrameArenaCapacity) : block(new std::byte[capacity]), capacity(capacity) {}
+
+	// Uninitialized storage for count trivially destructible Ts; nothing is ever destroyed.
+	template <typename T>
+	std::span<T> Array(size_t count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "frame arena memory is dropped, never destroyed");
+		return { static_cast<T*>(Allocate(count * sizeof(T), alignof(T))), count };
+	}
+
+	void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+	{
+		size_t offset = top.fetch_add(bytes + alignment - 1, std::memory_order_relaxed);
+		if (offset + bytes + alignment - 1 <= capacity) return Align(block.get() + offset, alignment);
+
+		// out of room: heap for now, Reset sizes the block so the next frame fits
+		std::lock_guard lock(overflowMutex);
+		overflow.push_back(std::make_unique<std::byte[]>(bytes + alignment - 1));
+		overflowBytes += bytes + alignment - 1;
+		return Align(overflow.back().get(), alignment);
+	}
+
+	// Mark and Rewind free everything allocated in between. Only for a single thread's
+	// scratch while nobody else allocates, see ArenaScope.
+	size_t Mark() const { return top.load(std::memory_order_relaxed); }
+	void Rewind(size_t mark)
+	{
+		size_t current = top.load(std::memory_order_relaxed);
+		highWater = (std::max)(highWater, (std::min)(current, capacity) + overflowBytes);
+		top.store((std::min)(mark, current), std::memory_order_relaxed);
+	}
+
+	// Drops everything. Called by the window between frames.
+	void Reset()
+	{
+		size_t used = (std::min)(top.load(std::memory_order_relaxed), capacity) + overflowBytes;
+		highWater = (std::max)(highWater, used);
+		if (!overflow.empty())
+		{
+			overflow.clear();
+			overflowBytes = 0;
+			capacity = highWater + highWater / 2;
+			block.reset(new std::byte[capacity]);
+			grown++;
+		}
+		top.store(0, std::memory_order_relaxed);
+	}
+
+	size_t Capacity() const { return capacity; }
+	size_t HighWater() const { return highWater; }
+	int Grown() const { return grown; }
+
+private:
+	std::unique_ptr<std::byte[]> block;
+	size_t capacity;
+	std::atomic<size_t> top{ 0 };
+	std::mutex overflowMutex;
+	std::vector<std::unique_ptr<std::byte[]>> overflow;
+	size_t overflowBytes = 0;
+	size_t highWater = 0;
+	int grown = 0;
+
+	static void* Align(std::byte* p, size_t alignment)
+	{
+		uintptr_t address = reinterpret_cast<uintptr_t>(p);
+		return reinterpret_cast<void*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	}
+};
+
+// The arena every per-frame system shares.
+inline FrameArena& FrameMemory()
+{
+	static FrameArena arena;
+	return arena;
+}
+
+// Hands back whatever was allocated in its lifetime, for scratch used inside one call.
+struct ArenaScope
+{
+	FrameArena& arena;
+	size_t mark;
+
+	explicit ArenaScope(FrameArena& arena = FrameMemory()) : arena(arena), mark(arena.Mark()) {}
+	~ArenaScope() { arena.Rewind(mark); }
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+// The calling thread's heap traffic between two Snapshot calls, as the window sees it once
+// per frame.
+struct FrameAllocations
+{
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+	uint64_t frees = 0;
+
+	static FrameAllocations Raw()
+	{
+		return { heapAllocations, heapAllocatedBytes, heapFrees };
+	}
+
+	static FrameAllocations Snapshot()
+	{
+		return Raw() - FrameAllocations{ exemptAllocations, exemptBytes, exemptFrees };
+	}
+
+	FrameAllocations operator-(const FrameAllocations& earlier) const
+	{
+		return { allocations - earlier.allocations, bytes - earlier.bytes, frees - earlier.frees };
+	}
+};
+
+// Deliberate one off heap use on a frame (a trace dump on a key press, say) that shouldn't
+// count as the frame allocating. Covers the thread it is on only.
+struct AllocationExemption
+{
+	FrameAllocations before = FrameAllocations::Raw();
+
+	AllocationExemption() = default;
+	~AllocationExemption()
+	{
+		FrameAllocations used = FrameAllocations::Raw() - before;
+		exemptAllocations += used.allocations;
+		exemptBytes += used.bytes;
+		exemptFrees += used.frees;
+	}
+	AllocationExemption(const AllocationExemption&) = delete;
+	AllocationExemption& operator=(const AllocationExemption&) = delete;
+};
@@ -0,0 +1,192 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+/*=============================================================================+/
+								  Tile Grid
+/+=============================================================================*/
+
+constexpr int MapSize = 512;                              // <-- tiles per side, matches the Grid SSBO
+constexpr int OccupancyRowWords = MapSize / 32;            // <-- 32 tiles per word
+constexpr int OccupancyWords = MapSize * OccupancyRowWords;
+
+using TileMap = std::array<float, MapSize * MapSize>;
+using OccupancyBits = std::array<uint32_t, OccupancyWords>;
+
+inline bool IsWallValue(float tileValue)
+{
+	return tileValue >= 0.5f;
+}
+
+// Packs the float tile map into one bit per tile, bit x & 31 of word (y * 16 + x / 32).
+// Same layout as the Occupancy SSBO (binding 1) so it can be uploaded as-is.
+inline void PackOccupancy(const TileMap& tiles, OccupancyBits& bits)
+{
+	for (int w = 0; w < OccupancyWords; w++)
+	{
+		const float* run = tiles.data() + w * 32;
+		uint32_t word = 0;
+		for (int b = 0; b < 32; b++)
+		{
+			word |= (uint32_t)IsWallValue(run[b]) << b;
+		}
+		bits[w] = word;
+	}
+}
+
+// Repacks just the words covering tiles [x0, x1) x [y0, y1), after those tiles changed.
+inline void PackOccupancyRect(const TileMap& tiles, OccupancyBits& bits, int x0, int y0, int x1, int y1)
+{
+	for (int y = y0; y < y1; y++)
+	{
+		for (int w = x0 >> 5; w <= (x1 - 1) >> 5; w++)
+		{
+			const float* run = tiles.data() + (size_t)y * MapSize + w * 32;
+			uint32_t word = 0;
+			for (int b = 0; b < 32; b++)
+			{
+				word |= (uint32_t)IsWallValue(run[b]) << b;
+			}
+			bits[y * OccupancyRowWords + w] = word;
+		}
+	}
+}
+
+// Anything outside the map counts as solid.
+inline bool IsOccupied(const OccupancyBits& bits, int x, int y)
+{
+	if ((unsigned)x >= (unsigned)MapSize || (unsigned)y >= (unsigned)MapSize) return true;
+	return (bits[y * OccupancyRowWords + (x >> 5)] >> (x & 31)) & 1u;
+}
+
+// Distance along the unit direction (dx, dy) from (ox, oy) to the first occupied tile, capped
+// at maxDist. Same side distance stepping as DDACheck, in 2D only; steps, if given, gets the
+// loop iterations as ddaSteps counts them.
+inline float CastRay(const OccupancyBits& bits, float ox, float oy, float dx, float dy, float maxDist, int* steps = nullptr)
+{
+	int x = (int)std::floor(ox);
+	int y = (int)std::floor(oy);
+	if (steps) *steps = 0;
+	if (IsOccupied(bits, x, y)) return 0.0f;
+
+	int stepX = dx > 0.0f ? 1 : -1;
+	int stepY = dy > 0.0f ? 1 : -1;
+	float deltaX = dx != 0.0f ? std::abs(1.0f / dx) : INFINITY;
+	float deltaY = dy != 0.0f ? std::abs(1.0f / dy) : INFINITY;
+	float sideX = dx != 0.0f ? (dx > 0.0f ? (float)(x + 1) - ox : ox - (float)x) * deltaX : INFINITY;
+	float sideY = dy != 0.0f ? (dy > 0.0f ? (float)(y + 1) - oy : oy - (float)y) * deltaY : INFINITY;
+
+	for (int step = 1;; step++)
+	{
+		float t;
+		if (sideX < sideY) { t = sideX; sideX += deltaX; x += stepX; }
+		else { t = sideY; sideY += deltaY; y += stepY; }
+		bool done = t >= maxDist || IsOccupied(bits, x, y);
+		if (!done) continue;
+		if (steps) *steps = step;
+		return (std::min)(t, maxDist);
+	}
+}
+
+// True when nothing solid lies between the two points.
+inline bool SegmentClear(const OccupancyBits& bits, float ax, float ay, float bx, float by)
+{
+	float dx = bx - ax;
+	float dy = by - ay;
+	float length = std::sqrt(dx * dx + dy * dy);
+	if (length == 0.0f) return !IsOccupied(bits, (int)std::floor(ax), (int)std::floor(ay));
+	return CastRay(bits, ax, ay, dx / length, dy / length, length) >= length;
+}
+
+/*
+	CastRay in 32.32 fixed point. Float side distances round differently depending on how
+	far the ray has gone and on what the compiler does with them, which decides ties and
+	the far end of long rays. Here the origin and deltas are converted once, exactly or by
+	truncation, and the stepping is integer adds and compares, so the same inputs give the
+	same hit on every compiler and machine. Side distances past FixedRayLimit tiles are
+	clamped there; nothing on the map is that far away.
+*/
+
+constexpr int64_t FixedOne = int64_t(1) << 32;
+constexpr int64_t FixedRayLimit = int64_t(2048) << 32;   // <-- well past the map diagonal
+
+struct FixedRay
+{
+	int64_t sideX, sideY;       // <-- distance to the next x and y side, 32.32
+	int64_t deltaX, deltaY;     // <-- distance between sides, 32.32
+	int x, y;
+	int stepX, stepY;
+};
+
+// (fraction * delta) >> 32 without a 128 bit product: fraction <= 1.0, delta < 2^43.
+inline int64_t FixedScale(int64_t fraction, int64_t delta)
+{
+	uint64_t high = (uint64_t)fraction * ((uint64_t)delta >> 32);
+	uint64_t low = ((uint64_t)fraction * ((uint64_t)delta & 0xFFFFFFFFu)) >> 32;
+	return (std::min)((int64_t)(high + low), FixedRayLimit);
+}
+
+inline FixedRay StartFixedRay(float ox, float oy, float dx, float dy)
+{
+	FixedRay ray;
+	int64_t fx = (int64_t)((double)ox * (double)FixedOne); // <-- exact for map coordinates; off the map
+	int64_t fy = (int64_t)((double)oy * (double)FixedOne); //     the shift below still floors
+	ray.x = (int)(fx >> 32);
+	ray.y = (int)(fy >> 32);
+	ray.stepX = dx > 0.0f ? 1 : -1;
+	ray.stepY = dy > 0.0f ? 1 : -1;
+	auto delta = [](float d)
+	{
+		double distance = (double)FixedOne / std::abs((double)d); // <-- one correctly rounded divide
+		return d != 0.0f && distance < (double)FixedRayLimit ? (int64_t)distance : FixedRayLimit;
+	};
+	ray.deltaX = delta(dx);
+	ray.deltaY = delta(dy);
+	int64_t toX = dx > 0.0f ? ((int64_t)(ray.x + 1) << 32) - fx : fx - ((int64_t)ray.x << 32);
+	int64_t toY = dy > 0.0f ? ((int64_t)(ray.y + 1) << 32) - fy : fy - ((int64_t)ray.y << 32);
+	ray.sideX = FixedScale(toX, ray.deltaX);
+	ray.sideY = FixedScale(toY, ray.deltaY);
+	return ray;
+}
+
+// CastRay with fixed point stepping; distances in 32.32.
+inline int64_t FixedRayDistance(const OccupancyBits& bits, float ox, float oy, float dx, float dy, int64_t maxDist, int* steps = nullptr)
+{
+	FixedRay ray = StartFixedRay(ox, oy, dx, dy);
+	if (steps) *steps = 0;
+	if (IsOccupied(bits, ray.x, ray.y)) return 0;
+	for (int step = 1;; step++)
+	{
+		int64_t t;
+		if (ray.sideX < ray.sideY) { t = ray.sideX; ray.sideX += ray.deltaX; ray.x += ray.stepX; }
+		else { t = ray.sideY; ray.sideY += ray.deltaY; ray.y += ray.stepY; }
+		bool done = t >= maxDist || IsOccupied(bits, ray.x, ray.y);
+		if (!done) continue;
+		if (steps) *steps = step;
+		return (std::min)(t, maxDist);
+	}
+}
+
+inline float CastRayFixed(const OccupancyBits& bits, float ox, float oy, float dx, float dy, float maxDist, int* steps = nullptr)
+{
+	int64_t limit = (std::min)((int64_t)((double)maxDist * (double)FixedOne), FixedRayLimit);
+	return (float)((double)FixedRayDistance(bits, ox, oy, dx, dy, limit, steps) / (double)FixedOne);
+}
+
+// Which traversal the CPU renderers (sprite column depths, agent observations) march with.
+enum class CpuRayMode
+{
+	Float,   // <-- CastRay
+	Fixed,   // <-- CastRayFixed, the same hit on every machine
+};
+
+inline std::atomic<CpuRayMode> cpuRayMode{ CpuRayMode::Float }; // <-- F toggles; read by job threads mid frame
+
+inline float TraceRay(const OccupancyBits& bits, float ox, float oy, float dx, float dy, float maxDist, int* steps = nullptr)
+{
+	if (cpuRayMode.load(std::memory_order_relaxed) == CpuRayMode::Fixed) return CastRayFixed(bits, ox, oy, dx, dy, maxDist, steps);
+	return CastRay(bits, ox, oy, dx, dy, maxDist, steps);
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+#include "Cpu.h"
+
+/*=============================================================================+/
+								    Hashing
+/+=============================================================================*/
+
+// CPU ports of the hashes in LIB.glsl, bit for bit, so CPU placement and GPU noise agree.
+
+inline uint32_t ChaoticHash(uint32_t seed)
+{
+	seed = (seed ^ 61u) ^ (seed >> 16u);
+	seed *= 9u;
+	seed = seed ^ (seed >> 4u);
+	seed *= 0x27d4eb2du;
+	seed = seed ^ (seed >> 15u);
+	return seed;
+}
+
+inline float UintToUnit(uint32_t x)
+{
+	uint32_t bits = 0x3F800000u | (x & 0x007FFFFFu); // <-- exponent=127, sign=0, 23 random mantissa bits
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f - 1.0f;                                 // <-- result [0.0, 1.0)
+}
+
+inline float P3DtoFloat(int32_t x, int32_t y, int32_t z)
+{
+	return UintToUnit(ChaoticHash(ChaoticHash((uint32_t)x + ChaoticHash((uint32_t)y + ChaoticHash((uint32_t)z)))));
+}
+
+// ChaoticHash over a whole array, out[i] = ChaoticHash(seeds[i]); in place is fine. The
+// vector versions need a 32 bit lane multiply, which SSE only has from SSE4.1.
+inline void HashBatchScalar(const uint32_t* seeds, uint32_t* out, int count)
+{
+	for (int i = 0; i < count; i++) out[i] = ChaoticHash(seeds[i]);
+}
+
+inline void HashBatchSse42(const uint32_t* seeds, uint32_t* out, int count)
+{
+	const __m128i k61 = _mm_set1_epi32(61), k9 = _mm_set1_epi32(9), kMix = _mm_set1_epi32(0x27d4eb2d);
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i h = _mm_loadu_si128((const __m128i*)(seeds + i));
+		h = _mm_xor_si128(_mm_xor_si128(h, k61), _mm_srli_epi32(h, 16));
+		h = _mm_mullo_epi32(h, k9);
+		h = _mm_xor_si128(h, _mm_srli_epi32(h, 4));
+		h = _mm_mullo_epi32(h, kMix);
+		h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+		_mm_storeu_si128((__m128i*)(out + i), h);
+	}
+	HashBatchScalar(seeds + i, out + i, count - i);
+}
+
+inline void HashBatchAvx2(const uint32_t* seeds, uint32_t* out, int count)
+{
+	const __m256i k61 = _mm256_set1_epi32(61), k9 = _mm256_set1_epi32(9), kMix = _mm256_set1_epi32(0x27d4eb2d);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i h = _mm256_loadu_si256((const __m256i*)(seeds + i));
+		h = _mm256_xor_si256(_mm256_xor_si256(h, k61), _mm256_srli_epi32(h, 16));
+		h = _mm256_mullo_epi32(h, k9);
+		h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 4));
+		h = _mm256_mullo_epi32(h, kMix);
+		h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+		_mm256_storeu_si256((__m256i*)(out + i), h);
+	}
+	HashBatchSse42(seeds + i, out + i, count - i);
+}
+
+inline void HashBatchAvx512(const uint32_t* seeds, uint32_t* out, int count)
+{
+	const __m512i k61 = _mm512_set1_epi32(61), k9 = _mm512_set1_epi32(9), kMix = _mm512_set1_epi32(0x27d4eb2d);
+	int i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512i h = _mm512_loadu_si512(seeds + i);
+		h = _mm512_xor_si512(_mm512_xor_si512(h, k61), _mm512_srli_epi32(h, 16));
+		h = _mm512_mullo_epi32(h, k9);
+		h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 4));
+		h = _mm512_mullo_epi32(h, kMix);
+		h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 15));
+		_mm512_storeu_si512(out + i, h);
+	}
+	HashBatchAvx2(seeds + i, out + i, count - i);
+}
+
+using HashBatchFn = void (*)(const uint32_t*, uint32_t*, int);
+inline const IsaKernel<HashBatchFn> hashBatchKernel({ HashBatchScalar, HashBatchSse42, HashBatchAvx2, HashBatchAvx512 });
+
+inline void HashBatch(const uint32_t* seeds, uint32_t* out, int count)
+{
+	hashBatchKernel.Get()(seeds, out, count);
+}
@@ -0,0 +1,396 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <cstdint>
+#include <algorithm>
+#include <string>
+
+#include "Profile.h"
+
+/*=============================================================================+/
+								  Job System
+/+=============================================================================*/
+
+/*
+	One pool of worker threads for everything that used to start its own: map generation,
+	collision, pathfinding, lighting, CPU rendering. Every worker owns a deque of jobs; it
+	pushes and pops its own at the back, and when that runs dry steals from the front of
+	someone else's, so the oldest (biggest) piece of work is what moves between threads.
+	Threads that aren't workers (the main thread) share slot 0.
+
+	A job is a range [begin, end) plus a function pointer and context, copied by value into
+	fixed size ring buffers, so submitting allocates nothing. Ranges split lazily: whoever
+	runs a job keeps halving it, pushing the upper half, until it is down to its grain, so
+	idle workers find large halves to steal and busy ones never pay for splits nobody takes.
+
+	Waiting is never idle: a thread waiting on a counter runs or steals jobs until the
+	counter drops to zero.
+*/
+
+constexpr int JobQueueCapacity = 4096;        // <-- per worker; a full queue runs the job inline instead
+
+struct Job
+{
+	void (*run)(void* context, int begin, int end) = nullptr;
+	void* context = nullptr;
+	int begin = 0, end = 0;
+	int grain = 1;                            // <-- split until at most this many indices remain
+	std::atomic<int>* pending = nullptr;      // <-- one count per live piece of this job
+};
+
+// Counters kept per worker, read by Stats. Aligned so workers never share a cache line.
+struct alignas(64) WorkerCounters
+{
+	std::atomic<uint64_t> jobs{ 0 };
+	std::atomic<uint64_t> steals{ 0 };         // <-- jobs taken from another worker's deque
+	std::atomic<uint64_t> failedSteals{ 0 };   // <-- full sweeps over every deque that found nothing
+	std::atomic<uint64_t> busyNs{ 0 };
+};
+
+struct WorkerStats
+{
+	uint64_t jobs = 0;
+	uint64_t steals = 0;
+	uint64_t failedSteals = 0;
+	double busyMs = 0.0;
+	double utilization = 0.0;                  // <-- busy time over wall time since ResetStats
+};
+
+struct JobStats
+{
+	double elapsedMs = 0.0;
+	std::vector<WorkerStats> workers;
+
+	uint64_t Jobs() const { uint64_t n = 0; for (const auto& w : workers) n += w.jobs; return n; }
+	uint64_t Steals() const { uint64_t n = 0; for (const auto& w : workers) n += w.steals; return n; }
+	double Utilization() const
+	{
+		double total = 0.0;
+		for (const auto& w : workers) total += w.utilization;
+		return workers.empty() ? 0.0 : total / workers.size();
+	}
+};
+
+class JobSystem
+{
+public:
+	JobSystem() = default;
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	~JobSystem() { Stop(); }
+
+	// Starts workers - 1 threads; the calling thread works as slot 0. Restarting with a
+	// different count is how the scaling benchmarks compare.
+	void Start(int workers)
+	{
+		Stop();
+		workers = (std::max)(workers, 1);
+		queues = std::vector<Queue>(workers);
+		counters = std::vector<WorkerCounters>(workers);
+		stopping = false;
+		ResetStats();
+		for (int worker = 1; worker < workers; worker++) threads.emplace_back([this, worker] { WorkerLoop(worker); });
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& thread : threads) thread.join();
+		threads.clear();
+	}
+
+	int Workers() const { return (int)queues.size(); }
+
+	// Calls body(i) for every i in [begin, end) across the pool and returns once all are done.
+	// grain 0 picks one that leaves a few pieces per worker.
+	template <typename Body>
+	void For(int begin, int end, Body&& body, int grain = 0)
+	{
+		int count = end - begin;
+		if (count <= 0) return;
+		if (grain <= 0) grain = (std::max)(1, count / (Workers() * 8));
+		if (Workers() == 1 || count <= grain)
+		{
+			for (int i = begin; i < end; i++) body(i);
+			return;
+		}
+
+		using BodyType = std::remove_reference_t<Body>;
+		std::atomic<int> pending{ 1 };
+		Job job;
+		job.run = [](void* context, int first, int last)
+		{
+			BodyType& f = *static_cast<BodyType*>(context);
+			for (int i = first; i < last; i++) f(i);
+		};
+		job.context = (void*)&body;
+		job.begin = begin;
+		job.end = end;
+		job.grain = grain;
+		job.pending = &pending;
+		Execute(job);
+		Wait(pending);
+	}
+
+	// Queues one job without waiting; pending must already count it.
+	void Submit(const Job& job)
+	{
+		if (!Push(Slot(), job)) Execute(job);
+	}
+
+	// Runs and steals jobs until pending reaches zero.
+	void Wait(const std::atomic<int>& pending)
+	{
+		int slot = Slot();
+		while (pending.load(std::memory_order_acquire) != 0)
+		{
+			Job job;
+			if (Pop(slot, job) || Steal(slot, job)) Execute(job);
+			else std::this_thread::yield();
+		}
+	}
+
+	void ResetStats()
+	{
+		for (auto& c : counters)
+		{
+			c.jobs = 0; c.steals = 0; c.failedSteals = 0; c.busyNs = 0;
+		}
+		statsStart = std::chrono::steady_clock::now();
+	}
+
+	JobStats Stats() const
+	{
+		JobStats stats;
+		stats.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - statsStart).count();
+		for (const auto& c : counters)
+		{
+			WorkerStats w;
+			w.jobs = c.jobs.load(std::memory_order_relaxed);
+			w.steals = c.steals.load(std::memory_order_relaxed);
+			w.failedSteals = c.failedSteals.load(std::memory_order_relaxed);
+			w.busyMs = c.busyNs.load(std::memory_order_relaxed) * 1e-6;
+			w.utilization = stats.elapsedMs > 0.0 ? w.busyMs / stats.elapsedMs : 0.0;
+			stats.workers.push_back(w);
+		}
+		return stats;
+	}
+
+private:
+	struct alignas(64) Queue
+	{
+		std::mutex mutex;
+		Job jobs[JobQueueCapacity];
+		int head = 0;   // <-- oldest, where thieves take from
+		int size = 0;
+	};
+
+	std::vector<Queue> queues;
+	std::vector<WorkerCounters> counters;
+	std::vector<std::thread> threads;
+	std::chrono::steady_clock::time_point statsStart;
+
+	// sleeping workers, woken whenever something is pushed
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<int> queued{ 0 };
+	bool stopping = false;
+
+	static int& ThreadSlot()
+	{
+		thread_local int slot = 0; // <-- workers set theirs, everyone else shares 0
+		return slot;
+	}
+
+	int Slot() const { return (std::min)(ThreadSlot(), Workers() - 1); }
+
+	bool Push(int slot, const Job& job)
+	{
+		Queue& q = queues[slot];
+		{
+			std::lock_guard lock(q.mutex);
+			if (q.size == JobQueueCapacity) return false;
+			q.jobs[(q.head + q.size) % JobQueueCapacity] = job;
+			q.size++;
+		}
+		queued.fetch_add(1, std::memory_order_release);
+		wake.notify_one();
+		return true;
+	}
+
+	bool Pop(int slot, Job& job)
+	{
+		Queue& q = queues[slot];
+		std::lock_guard lock(q.mutex);
+		if (q.size == 0) return false;
+		q.size--;
+		job = q.jobs[(q.head + q.size) % JobQueueCapacity];
+		queued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool Steal(int slot, Job& job)
+	{
+		int workers = Workers();
+		thread_local uint32_t seed = 0x9E3779B9u;
+		seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+		int start = (int)(seed % (uint32_t)workers);
+		for (int k = 0; k < workers; k++)
+		{
+			int victim = (start + k) % workers;
+			if (victim == slot) continue;
+			Queue& q = queues[victim];
+			std::lock_guard lock(q.mutex);
+			if (q.size == 0) continue;
+			job = q.jobs[q.head];
+			q.head = (q.head + 1) % JobQueueCapacity;
+			q.size--;
+			queued.fetch_sub(1, std::memory_order_relaxed);
+			counters[slot].steals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+		counters[slot].failedSteals.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Splits off upper halves until job is down to its grain, then runs what is left.
+	void Execute(Job job)
+	{
+		int slot = Slot();
+		while (job.end - job.begin > job.grain)
+		{
+			Job upper = job;
+			upper.begin = job.begin + (job.end - job.begin) / 2;
+			job.pending->fetch_add(1, std::memory_order_relaxed);
+			if (!Push(slot, upper))
+			{
+				job.pending->fetch_sub(1, std::memory_order_relaxed);
+				break;
+			}
+			job.end = upper.begin;
+		}
+		auto start = std::chrono::steady_clock::now();
+		{
+			PROFILE_SCOPE("job");
+			job.run(job.context, job.begin, job.end);
+		}
+		auto end = std::chrono::steady_clock::now();
+		counters[slot].jobs.fetch_add(1, std::memory_order_relaxed);
+		counters[slot].busyNs.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), std::memory_order_relaxed);
+		job.pending->fetch_sub(1, std::memory_order_release);
+	}
+
+	void WorkerLoop(int worker)
+	{
+		ThreadSlot() = worker;
+		Profile().NameThread(("worker " + std::to_string(worker)).c_str());
+		while (true)
+		{
+			Job job;
+			if (Pop(worker, job) || Steal(worker, job))
+			{
+				Execute(job);
+				continue;
+			}
+			std::unique_lock lock(sleepMutex);
+			wake.wait_for(lock, std::chrono::milliseconds(1), [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+			if (stopping) return;
+		}
+	}
+};
+
+// The process wide pool, one worker per hardware thread, started on first use.
+inline JobSystem& Jobs()
+{
+	static JobSystem jobs;
+	static std::once_flag started;
+	std::call_once(started, [] { jobs.Start((int)(std::max)(1u, std::thread::hardware_concurrency())); });
+	return jobs;
+}
+
+/*=============================================================================+/
+								   Job Graph
+/+=============================================================================*/
+
+/*
+	Jobs with dependencies, built once and run as often as needed. Each node counts the
+	nodes it still waits on; finishing one decrements its successors and submits those that
+	reach zero, so independent branches run side by side and nothing polls.
+*/
+
+class JobGraph
+{
+public:
+	// Adds work that starts once every node in after has finished. Returns its id.
+	int Add(std::function<void()> work, std::initializer_list<int> after = {})
+	{
+		int id = (int)nodes.size();
+		nodes.push_back(std::make_unique<Node>());
+		Node& node = *nodes.back();
+		node.graph = this;
+		node.work = std::move(work);
+		node.dependencies = (int)after.size();
+		for (int before : after) nodes[before]->next.push_back(id);
+		return id;
+	}
+
+	// Runs every node on system and returns when the last one is done.
+	void Run(JobSystem& system)
+	{
+		this->system = &system;
+		remaining.store((int)nodes.size(), std::memory_order_relaxed);
+		for (auto& node : nodes) node->waiting.store(node->dependencies, std::memory_order_relaxed);
+		for (auto& node : nodes)
+		{
+			if (node->dependencies == 0) Submit(*node);
+		}
+		system.Wait(remaining);
+	}
+
+private:
+	struct Node
+	{
+		JobGraph* graph = nullptr;
+		std::function<void()> work;
+		std::vector<int> next;
+		int dependencies = 0;
+		std::atomic<int> waiting{ 0 };
+	};
+
+	std::vector<std::unique_ptr<Node>> nodes;
+	std::atomic<int> remaining{ 0 };
+	JobSystem* system = nullptr;
+
+	void Submit(Node& node)
+	{
+		Job job;
+		job.run = [](void* context, int, int)
+		{
+			Node& node = *static_cast<Node*>(context);
+			node.work();
+			// successors are submitted before this node counts as done, so remaining never
+			// reaches zero while one is still unqueued
+			for (int id : node.next)
+			{
+				Node& successor = *node.graph->nodes[id];
+				if (successor.waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) node.graph->Submit(successor);
+			}
+		};
+		job.context = &node;
+		job.begin = 0;
+		job.end = 1;
+		job.pending = &remaining;
+		system->Submit(job);
+	}
+};
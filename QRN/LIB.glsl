@@ -0,0 +1,325 @@
+// Shared shading library, spliced in after the #version line of any shader that lists it as an include.
+
+float playerHeight = 2.0; // <-- is the player's eye height off the ground
+int ddaSteps = 0;         // <-- loop iterations of the last DDACheck, for the step heatmap
+
+layout(binding = 1) uniform sampler2D lightmap; // <-- baked on the CPU, rg = (ambient occlusion, point light)
+const float lightmapTexels = 4.0;               // <-- texels per tile side, LightmapTexels in Lightmap.h
+
+layout(binding = 2) uniform sampler2D distanceField; // <-- per tile distance to the nearest wall, clamped, DistanceField.h
+const float tileDiagonal = 1.41421356;
+
+struct Light
+{
+	vec4 position;	// <-- xyz, w = radius
+	vec4 intensity;	// <-- x = intensity, y = 1 if it casts shadows
+};
+layout(std430, binding = 2) readonly buffer Lights { Light lights[]; };
+layout(std430, binding = 3) readonly buffer LightClusters { uvec2 clusterRanges[]; };	// <-- (first index, count) per cluster
+layout(std430, binding = 4) readonly buffer LightIndices { uint lightIndices[]; };
+const int lightClusterSize = 8;							// <-- tiles per cluster side, LightClusterSize in Lights.h
+const int lightClusters = 512 / lightClusterSize;
+
+/*=============================================================+/
+							 Structs
+/+=============================================================*/
+
+struct HitInfo
+{
+	vec2 uv;		// <-- uv coordinates on the face we hit
+	ivec3 face;		// <-- which face we hit (x, y, or z)
+	ivec3 normal;	// <-- outward normal of the face we hit
+	ivec2 tileID;	// <-- which tile we hit
+	int tileType;	// <-- what type of tile we hit
+	float dist;		// <-- distance from ray origin to hit point
+	vec3 point;		// <-- point of intersection
+};
+
+/*=============================================================+/
+							Functions
+/+=============================================================*/
+
+int TileAt(ivec2 maploc); // <-- defined by the including shader, reads whatever map storage it has bound
+
+// black -> blue -> green -> yellow -> red -> white as steps go 0 -> 128 and beyond
+vec3 Heat(float steps)
+{
+	float t = clamp(steps / 128.0, 0.0, 1.0) * 5.0;
+	vec3 ramp[6] = vec3[](vec3(0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(1.0));
+	int i = min(int(t), 4);
+	return mix(ramp[i], ramp[i + 1], t - float(i));
+}
+
+uint rotmul(uint a, uint b)
+{
+	uint c = 0;
+
+	for (int i = 0; i < 32; i++) {
+    uint rotated = (a << i) | (a >> (32 - i));
+    uint mask = (b >> i) & 1u;
+    c ^= rotated & (0u - mask);
+}
+
+	return c;
+}
+
+uint chaoticHash(uint seed)
+{
+    seed = (seed ^ 61u) ^ (seed >> 16u);
+    seed *= 9u;
+    seed = seed ^ (seed >> 4u);
+    seed *= 0x27d4eb2du;
+    seed = seed ^ (seed >> 15u);
+    return seed;
+}
+
+float uint_to_unit(uint x)
+{
+    // keep only 23 mantissa bits
+    uint mantissa = x & 0x007FFFFFu;      // mask out bottom 23 bits
+    uint bits = 0x3F800000u | mantissa;   // exponent=127, sign=0
+    return uintBitsToFloat(bits) - 1.0;   // result [0.0, 1.0)
+}
+
+float p1DtoFloat(uint p)
+{
+	return uint_to_unit(chaoticHash(p));
+}
+
+float p2DtoFloat(ivec2 coord)
+{
+	return uint_to_unit(floatBitsToUint(p1DtoFloat(coord.r) + p1DtoFloat(coord.g)));
+}
+
+float p3DtoFloat(ivec3 coord)
+{
+	return uint_to_unit(
+	chaoticHash(
+	chaoticHash(uint(coord.x) +
+	chaoticHash(uint(coord.y) +
+	chaoticHash(uint(coord.z)
+	)))));
+}
+
+float p4DtoFloat(ivec4 coord)
+{
+	return uint_to_unit(floatBitsToUint(p2DtoFloat(coord.rg) + p2DtoFloat(coord.ba)));
+}
+
+ivec2 vec2AsIvec2(vec2 v)
+{
+	return ivec2
+	(
+		floatBitsToInt(v.x),
+		floatBitsToInt(v.y)
+	);
+}
+
+ivec3 vec3AsIvec3(vec3 v)
+{
+	return ivec3
+	(
+		floatBitsToInt(v.x),
+		floatBitsToInt(v.y),
+		floatBitsToInt(v.z)
+	);
+}
+
+ivec4 vec4AsIvec4(vec4 v)
+{
+	return ivec4
+	(
+		floatBitsToInt(v.r),
+		floatBitsToInt(v.g),
+		floatBitsToInt(v.b),
+		floatBitsToInt(v.a)
+	);
+}	
+
+bool IsWall(ivec2 maploc)
+{
+	return (TileAt(maploc) > 0);
+}
+
+vec3 minMask(vec3 vec)
+{
+	float m = min(min(vec.x, vec.y), vec.z);
+	vec3 mask = vec3(float(vec.x == m), float(vec.y == m), float(vec.z == m));
+	return mask;
+}
+
+// Builds the hit record for a ray that struck the face picked out by mask at distance dist.
+// Shared by DDACheck and the raster path, so both shade with the same uv/face conventions.
+HitInfo FaceHit(vec3 ro, vec3 rd, float dist, vec3 mask, ivec2 tileid)
+{
+	HitInfo hitinfo;
+	hitinfo.face = ivec3(-sign(rd));
+	hitinfo.face.y *= -1;
+	hitinfo.normal = ivec3(-sign(rd) * mask);
+	vec3 point = ro + rd * dist;
+	hitinfo.point = point;
+	point *= 1.0 - mask; // <-- zero out the axis we traveled on
+	point = fract(point); // <-- get the uv coords on the face we hit
+	point.xy = fract(point.xy * dot(vec3(hitinfo.face), mask));
+	vec2 uv = 
+	point.xy * mask.z +
+	point.yz * mask.x +
+	point.xz * mask.y;
+
+	hitinfo.uv = uv;
+	hitinfo.tileID = tileid;
+	hitinfo.tileType = TileAt(tileid);
+	hitinfo.dist = dist;
+	return hitinfo;
+}
+
+// Free space guaranteed around any point in the tile; off the map there is none.
+float Clearance(ivec2 maploc)
+{
+	if (any(lessThan(maploc, ivec2(0))) || any(greaterThanEqual(maploc, ivec2(512)))) return 0.0;
+	return texelFetch(distanceField, maploc, 0).r - tileDiagonal;
+}
+
+HitInfo DDACheck(vec3 ro, vec3 rd)
+{
+	float zdist = abs(playerHeight / rd.z);		// <-- distance to the floor / cieling.
+	zdist = min(zdist, 1000.0);					// <-- clamp to avoid infinities
+
+	// sphere trace across open space first, then step tile by tile near walls
+	float horizontal = length(rd.xy);
+	float t = 0.0;
+	ddaSteps = 0;
+	for (int i = 0; i < 32 && t < zdist; i++)
+	{
+		ddaSteps++;
+		float clearance = Clearance(ivec2(floor(ro.xy + rd.xy * t)));
+		if (clearance < 1.0) break;				// <-- not worth leaving the DDA for less than a tile
+		t += clearance / horizontal;
+	}
+	t = min(t, zdist);
+	vec3 point = ro + rd * t;
+
+	ivec2 tileid = ivec2(floor(point.xy));
+	ivec2 tstep = ivec2(sign(rd.xy));
+
+	vec2 deltas = abs(vec2(1.0) / rd.xy);											// <-- distance between x-side and y-side checks
+	vec3 sideDists = vec3(fract(1.0 - (point.xy * vec2(tstep))) * deltas + t, zdist);	// <-- distance from ray origin to first x-side and y-side checks
+	vec3 totdists = vec3(t);														// <-- total distance traveled along the ray
+	totdists.z = sideDists.z;														// <-- initialize z distances
+
+	vec3 mask = vec3(0.0);
+
+	while(mask.z == 0.0 && !IsWall(tileid))
+	{
+		ddaSteps++;
+		mask = minMask(sideDists);
+		tileid += ivec2(tstep * ivec2(mask.xy));
+		totdists = sideDists;
+		sideDists.xy += deltas * mask.xy;
+	}
+	mask = minMask(totdists);
+	float dist = min(totdists.z, min(totdists.x, totdists.y));
+	return FaceHit(ro, rd, dist, mask, tileid);
+}
+
+// Looks up the baked lighting for the hit in its tile's 4x4 block of the atlas. Walls use
+// the block row of their face, floor and ceiling share the whole block.
+vec2 LightmapAt(HitInfo hit)
+{
+	vec2 block = vec2(hit.tileID) * lightmapTexels;
+	vec2 local;
+	if (hit.normal.z != 0)
+	{
+		local = fract(hit.point.xy) * lightmapTexels;
+	}
+	else
+	{
+		int slot = hit.normal.x > 0 ? 0 : hit.normal.x < 0 ? 1 : hit.normal.y > 0 ? 2 : 3;
+		float along = hit.normal.x != 0 ? fract(hit.point.y) : fract(hit.point.x);
+		local = vec2(along * lightmapTexels, float(slot) + 0.5);
+	}
+	local = clamp(local, vec2(0.5), vec2(lightmapTexels - 0.5)); // <-- keep bilinear filtering inside the block
+	return textureLod(lightmap, (block + local) / vec2(textureSize(lightmap, 0)), 0.0).rg;
+}
+
+// Any-hit visibility between two points on the floor plan; walls are full height, so a light
+// is hidden exactly when a wall tile lies on the 2D segment. Same side distance stepping as
+// DDACheck, but one scalar compare per step instead of minMask, no z plane, no hit record,
+// and it stops at the first wall or the end of the segment.
+bool ShadowRay(vec2 from, vec2 to)
+{
+	vec2 rd = to - from;
+	float len = length(rd);
+	if (len == 0.0) return true;
+	rd /= len;
+
+	ivec2 tileid = ivec2(floor(from));
+	ivec2 target = ivec2(floor(to));
+	ivec2 tstep = ivec2(sign(rd));
+	vec2 deltas = abs(vec2(1.0) / rd);
+	vec2 sideDists = fract(1.0 - (from * vec2(tstep))) * deltas;
+	sideDists = mix(sideDists, vec2(1e30), equal(tstep, ivec2(0)));	// <-- axis aligned rays never cross that axis
+
+	for (int i = 0; i < 64 && tileid != target; i++)
+	{
+		if (min(sideDists.x, sideDists.y) >= len) break;
+		if (sideDists.x < sideDists.y)
+		{
+			tileid.x += tstep.x;
+			sideDists.x += deltas.x;
+		}
+		else
+		{
+			tileid.y += tstep.y;
+			sideDists.y += deltas.y;
+		}
+		if (IsWall(tileid)) return false;
+	}
+	return true;
+}
+
+// Dynamic point lights, only the ones the CPU binned into the hit's cluster.
+float DynamicLighting(HitInfo hit)
+{
+	ivec2 cluster = clamp(ivec2(floor(hit.point.xy / float(lightClusterSize))), ivec2(0), ivec2(lightClusters - 1));
+	uvec2 range = clusterRanges[cluster.y * lightClusters + cluster.x];
+	vec3 n = vec3(hit.normal);
+	vec3 p = hit.point + n * 0.01;
+
+	float light = 0.0;
+	for (uint i = range.x; i < range.x + range.y; i++)
+	{
+		Light l = lights[lightIndices[i]];
+		vec3 toLight = l.position.xyz - p;
+		float dist2 = dot(toLight, toLight);
+		float radius2 = l.position.w * l.position.w;
+		if (dist2 >= radius2) continue;
+
+		float cosine = dot(n, toLight) * inversesqrt(dist2);
+		if (cosine <= 0.0) continue;
+		if (l.intensity.y != 0.0 && !ShadowRay(p.xy, l.position.xy)) continue;
+
+		float window = 1.0 - dist2 / radius2;
+		light += l.intensity.x * cosine * window * window / (1.0 + dist2);
+	}
+	return light;
+}
+
+float getValue(HitInfo hit)
+{
+	float val;
+
+	vec2 baked = LightmapAt(hit);
+
+	float dval = 7.0 / (hit.dist * hit.dist + 6.0) * baked.r + baked.g + DynamicLighting(hit);
+
+	float wallval = max(abs(hit.uv.x-0.5), abs(hit.uv.y -0.5)) * 2.0;
+
+	wallval = 1.0 - wallval;
+	wallval *= 5.0 * sqrt(5.0);
+	wallval = clamp(wallval, 0.0, 1.0);
+	
+	val = dval * wallval;
+
+	return val;
+}
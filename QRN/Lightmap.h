@@ -0,0 +1,240 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <numbers>
+#include <algorithm>
+
+#include "Grid.h"
+#include "Parallel.h"
+
+/*=============================================================================+/
+								 Baked Lightmaps
+/+=============================================================================*/
+
+/*
+	Atlas layout, RG8 (r = ambient occlusion, g = point light), one 4x4 texel block per tile:
+		wall tile:  row = face slot (+x, -x, +y, -y), column = sample along the face
+		open tile:  4x4 samples over the floor, shared with the ceiling above it
+	Faces that touch another wall are never seen and are left black.
+*/
+
+constexpr int LightmapTexels = 4;                                   // <-- texels per tile side
+constexpr int LightmapAtlasSize = MapSize * LightmapTexels;
+constexpr int LightmapChunkSize = 16;                               // <-- tiles per chunk side
+constexpr int LightmapChunks = MapSize / LightmapChunkSize;         // <-- chunks per side
+
+constexpr int AORays = 12;
+constexpr float AORange = 2.0f;
+constexpr float WallSampleHeight = 2.0f;                            // <-- wall samples sit at eye height
+
+struct PointLight
+{
+	float x, y, z;
+	float intensity;
+	float radius;      // <-- no contribution past this
+};
+
+// One light per 24x24 block, in the middle of the block when that tile is open.
+inline std::vector<PointLight> PlaceLights(const OccupancyBits& bits)
+{
+	std::vector<PointLight> lights;
+	for (int y = 12; y < MapSize; y += 24)
+	{
+		for (int x = 12; x < MapSize; x += 24)
+		{
+			if (IsOccupied(bits, x, y)) continue;
+			lights.push_back({ (float)x + 0.5f, (float)y + 0.5f, 3.5f, 6.0f, 12.0f });
+		}
+	}
+	return lights;
+}
+
+// True if any wall is within AORange of tile (x, y), otherwise its floor is fully unoccluded.
+inline bool NearWall(const OccupancyBits& bits, int x, int y)
+{
+	constexpr int reach = (int)AORange + 1;
+	for (int dy = -reach; dy <= reach; dy++)
+		for (int dx = -reach; dx <= reach; dx++)
+			if (IsOccupied(bits, x + dx, y + dy)) return true;
+	return false;
+}
+
+// Lighting at one sample: p is on the surface, (nx, ny) its horizontal normal (zero for the
+// floor) and z its height. Returns ambient occlusion and light in [0, 1].
+inline std::array<float, 2> LightSample(const OccupancyBits& bits, const std::vector<const PointLight*>& lights,
+	float px, float py, float z, float nx, float ny, bool occluded = true)
+{
+	// start just off the surface so rays don't hit the wall they leave
+	px += nx * 0.01f;
+	py += ny * 0.01f;
+
+	bool floor = nx == 0.0f && ny == 0.0f;
+	float baseAngle = std::atan2(ny, nx);
+	float spread = floor ? 2.0f * std::numbers::pi_v<float> : std::numbers::pi_v<float>;
+	float ao = 1.0f;
+	if (occluded)
+	{
+		float open = 0.0f;
+		for (int i = 0; i < AORays; i++)
+		{
+			float angle = baseAngle + spread * (((float)i + 0.5f) / (float)AORays - 0.5f);
+			open += CastRay(bits, px, py, std::cos(angle), std::sin(angle), AORange);
+		}
+		ao = open / (AORange * (float)AORays);
+	}
+
+	float light = 0.0f;
+	for (const PointLight* l : lights)
+	{
+		float dx = l->x - px;
+		float dy = l->y - py;
+		float dz = l->z - z;
+		float dist2 = dx * dx + dy * dy + dz * dz;
+		if (dist2 >= l->radius * l->radius) continue;
+
+		float dist = std::sqrt(dist2);
+		float cosine = floor ? dz / dist : (dx * nx + dy * ny) / dist;
+		if (cosine <= 0.0f) continue;
+		if (!SegmentClear(bits, px, py, l->x, l->y)) continue;
+
+		float window = 1.0f - dist2 / (l->radius * l->radius);
+		light += l->intensity * cosine * window * window / (1.0f + dist2);
+	}
+	return { ao, (std::min)(light, 1.0f) };
+}
+
+struct LightmapBaker
+{
+	const OccupancyBits* bits = nullptr;
+	std::vector<PointLight> lights;
+	std::vector<uint8_t> atlas;     // <-- RG8, LightmapAtlasSize x LightmapAtlasSize
+	std::vector<int> pending;       // <-- chunk indices waiting to bake, taken from the back
+
+	// measurements
+	double bakeMs = 0.0;            // <-- time spent inside Bake since the last Reset
+	double lastBatchMs = 0.0;
+	int chunksBaked = 0;
+
+	void Reset(const OccupancyBits& occupancy, std::vector<PointLight> newLights)
+	{
+		bits = &occupancy;
+		lights = std::move(newLights);
+		atlas.assign((size_t)LightmapAtlasSize * LightmapAtlasSize * 2, 0);
+		for (size_t i = 0; i < atlas.size(); i += 2) atlas[i] = 255; // <-- unbaked reads as unoccluded, unlit
+		pending.clear();
+		for (int chunk = LightmapChunks * LightmapChunks - 1; chunk >= 0; chunk--) pending.push_back(chunk);
+		bakeMs = 0.0;
+		lastBatchMs = 0.0;
+		chunksBaked = 0;
+	}
+
+	// Queues a chunk to bake again, e.g. after a tile in or near it changed.
+	void Invalidate(int chunk)
+	{
+		if (std::find(pending.begin(), pending.end(), chunk) == pending.end()) pending.push_back(chunk);
+	}
+
+	// Queues every chunk a change to tiles [x0, x1) x [y0, y1) can reach: a texel is touched
+	// through its occlusion rays or a shadow ray to a light, and neither is longer than the
+	// reach of the farthest light.
+	void Invalidate(int x0, int y0, int x1, int y1)
+	{
+		float reach = AORange;
+		for (const PointLight& l : lights) reach = (std::max)(reach, l.radius);
+		int pad = (int)std::ceil(reach) + 1;
+		int cx0 = (std::max)(x0 - pad, 0) / LightmapChunkSize;
+		int cy0 = (std::max)(y0 - pad, 0) / LightmapChunkSize;
+		int cx1 = ((std::min)(x1 + pad, MapSize) - 1) / LightmapChunkSize;
+		int cy1 = ((std::min)(y1 + pad, MapSize) - 1) / LightmapChunkSize;
+		for (int cy = cy0; cy <= cy1; cy++)
+			for (int cx = cx0; cx <= cx1; cx++)
+				Invalidate(cy * LightmapChunks + cx);
+	}
+
+	bool Done() const { return pending.empty(); }
+
+	void BakeChunk(int chunk)
+	{
+		int cx = (chunk % LightmapChunks) * LightmapChunkSize;
+		int cy = (chunk / LightmapChunks) * LightmapChunkSize;
+
+		// only lights that can reach the chunk; per thread so baking allocates nothing once warm
+		thread_local std::vector<const PointLight*> nearby;
+		nearby.clear();
+		for (const PointLight& l : lights)
+		{
+			float ex = (std::max)({ (float)cx - l.x, 0.0f, l.x - (float)(cx + LightmapChunkSize) });
+			float ey = (std::max)({ (float)cy - l.y, 0.0f, l.y - (float)(cy + LightmapChunkSize) });
+			if (ex * ex + ey * ey < l.radius * l.radius) nearby.push_back(&l);
+		}
+
+		auto store = [&](int tx, int ty, int row, int column, std::array<float, 2> value)
+		{
+			size_t texel = (size_t)(ty * LightmapTexels + row) * LightmapAtlasSize + (size_t)(tx * LightmapTexels + column);
+			atlas[texel * 2 + 0] = (uint8_t)std::lround(value[0] * 255.0f);
+			atlas[texel * 2 + 1] = (uint8_t)std::lround(value[1] * 255.0f);
+		};
+
+		constexpr int normals[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+		for (int ty = cy; ty < cy + LightmapChunkSize; ty++)
+		{
+			for (int tx = cx; tx < cx + LightmapChunkSize; tx++)
+			{
+				if (!IsOccupied(*bits, tx, ty))
+				{
+					bool occluded = NearWall(*bits, tx, ty);
+					for (int row = 0; row < LightmapTexels; row++)
+						for (int column = 0; column < LightmapTexels; column++)
+							store(tx, ty, row, column, LightSample(*bits, nearby,
+								(float)tx + ((float)column + 0.5f) / LightmapTexels,
+								(float)ty + ((float)row + 0.5f) / LightmapTexels, 0.0f, 0.0f, 0.0f, occluded));
+					continue;
+				}
+
+				for (int slot = 0; slot < 4; slot++)
+				{
+					int nx = normals[slot][0];
+					int ny = normals[slot][1];
+					bool exposed = !IsOccupied(*bits, tx + nx, ty + ny);
+					for (int column = 0; column < LightmapTexels; column++)
+					{
+						if (!exposed) { store(tx, ty, slot, column, { 0.0f, 0.0f }); continue; }
+						float along = ((float)column + 0.5f) / LightmapTexels;
+						float px = nx != 0 ? (float)tx + (nx > 0 ? 1.0f : 0.0f) : (float)tx + along;
+						float py = ny != 0 ? (float)ty + (ny > 0 ? 1.0f : 0.0f) : (float)ty + along;
+						store(tx, ty, slot, column, LightSample(*bits, nearby, px, py, WallSampleHeight, (float)nx, (float)ny));
+					}
+				}
+			}
+		}
+	}
+
+	// Bakes batches of chunks, one chunk per worker, until the next batch would overrun
+	// budgetMs. At least one batch always runs so baking makes progress on any budget.
+	// Chunks finished by this call are appended to baked.
+	void Bake(double budgetMs, std::vector<int>& baked)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int workers = Jobs().Workers();
+		double elapsed = 0.0;
+		while (!pending.empty())
+		{
+			if (elapsed > 0.0 && elapsed + lastBatchMs > budgetMs) break;
+
+			int count = (std::min)((int)pending.size(), workers);
+			const int* batch = pending.data() + pending.size() - count;
+			auto batchStart = std::chrono::steady_clock::now();
+			ParallelFor(0, count, [&](int i) { BakeChunk(batch[i]); });
+			auto batchEnd = std::chrono::steady_clock::now();
+
+			baked.insert(baked.end(), batch, batch + count);
+			pending.resize(pending.size() - count);
+			chunksBaked += count;
+			lastBatchMs = std::chrono::duration<double, std::milli>(batchEnd - batchStart).count();
+			elapsed = std::chrono::duration<double, std::milli>(batchEnd - start).count();
+		}
+		bakeMs += elapsed;
+	}
+};
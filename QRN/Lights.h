@@ -0,0 +1,133 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "Grid.h"
+#include "Hash.h"
+
+/*=============================================================================+/
+								 Dynamic Lights
+/+=============================================================================*/
+
+// Lights are binned every frame into square clusters of tiles; a hit only shades against
+// the lights listed for the cluster it lands in. Sizes match LIB.glsl.
+constexpr int LightClusterSize = 8;                                 // <-- tiles per cluster side
+constexpr int LightClusters = MapSize / LightClusterSize;           // <-- clusters per side
+constexpr int MaxDynamicLights = 1024;
+constexpr int MaxClusterLightIndices = 64 * 1024;
+
+struct DynamicLight
+{
+	float baseX, baseY;     // <-- where it sways around
+	float z;
+	float radius;
+	float baseIntensity;
+	float phase;            // <-- per light offset so they don't flicker in step
+	float x, y;             // <-- this frame's position
+	float intensity;        // <-- this frame's intensity
+	bool castsShadows = true;
+};
+
+// std430 layout of one entry in the Lights SSBO (binding 2)
+struct GpuLight
+{
+	float position[4];      // <-- xyz, w = radius
+	float intensity[4];     // <-- x = intensity, y = 1 if it casts shadows, rest padding
+};
+
+struct LightClusterGrid
+{
+	std::vector<uint32_t> ranges;   // <-- per cluster (first index, count), binding 3
+	std::vector<uint32_t> indices;  // <-- light indices grouped by cluster, binding 4
+	std::vector<GpuLight> gpuLights;
+	int overflowed = 0;             // <-- light/cluster pairs dropped last frame for lack of space
+};
+
+// Scatters count lights over open tiles, placement picked by hash so it is the same every run.
+inline std::vector<DynamicLight> SpawnDynamicLights(const OccupancyBits& bits, int count, uint32_t seed)
+{
+	std::vector<DynamicLight> lights;
+	for (uint32_t attempt = 0; (int)lights.size() < count && attempt < (uint32_t)count * 16u; attempt++)
+	{
+		int x = (int)(ChaoticHash(seed ^ (attempt * 2u + 0u)) % (uint32_t)MapSize);
+		int y = (int)(ChaoticHash(seed ^ (attempt * 2u + 1u)) % (uint32_t)MapSize);
+		if (IsOccupied(bits, x, y)) continue;
+		float phase = UintToUnit(ChaoticHash(seed + attempt)) * 100.0f;
+		lights.push_back({ (float)x + 0.5f, (float)y + 0.5f, 3.0f, 6.0f, 3.0f, phase, (float)x + 0.5f, (float)y + 0.5f, 3.0f });
+	}
+	return lights;
+}
+
+// Per frame animation: a slow sway plus a fast, irregular flicker.
+inline void AnimateLights(std::vector<DynamicLight>& lights, double time)
+{
+	for (DynamicLight& l : lights)
+	{
+		float t = (float)time + l.phase;
+		l.x = l.baseX + 0.3f * std::sin(t * 0.7f);
+		l.y = l.baseY + 0.3f * std::cos(t * 0.5f);
+		float flicker = 0.5f * std::sin(t * 13.0f) + 0.3f * std::sin(t * 31.0f + 1.7f) + 0.2f * std::sin(t * 57.0f + 4.1f);
+		l.intensity = l.baseIntensity * (0.75f + 0.25f * flicker);
+	}
+}
+
+// Counting sort of light/cluster pairs: count per cluster, prefix sum to each cluster's end,
+// then fill backwards so every range ends up pointing at its first index.
+inline void BinLights(const std::vector<DynamicLight>& lights, LightClusterGrid& grid)
+{
+	constexpr int clusterCount = LightClusters * LightClusters;
+	grid.ranges.assign(clusterCount * 2, 0);
+	grid.gpuLights.clear();
+	grid.overflowed = 0;
+
+	int lightCount = (std::min)((int)lights.size(), MaxDynamicLights);
+	auto clusterBounds = [](const DynamicLight& l, int bounds[4])
+	{
+		bounds[0] = std::clamp((int)std::floor((l.x - l.radius) / LightClusterSize), 0, LightClusters - 1);
+		bounds[1] = std::clamp((int)std::floor((l.y - l.radius) / LightClusterSize), 0, LightClusters - 1);
+		bounds[2] = std::clamp((int)std::floor((l.x + l.radius) / LightClusterSize), 0, LightClusters - 1);
+		bounds[3] = std::clamp((int)std::floor((l.y + l.radius) / LightClusterSize), 0, LightClusters - 1);
+	};
+
+	for (int i = 0; i < lightCount; i++)
+	{
+		const DynamicLight& l = lights[i];
+		grid.gpuLights.push_back({ { l.x, l.y, l.z, l.radius }, { l.intensity, l.castsShadows ? 1.0f : 0.0f, 0.0f, 0.0f } });
+		int b[4];
+		clusterBounds(l, b);
+		for (int cy = b[1]; cy <= b[3]; cy++)
+			for (int cx = b[0]; cx <= b[2]; cx++)
+				grid.ranges[(cy * LightClusters + cx) * 2 + 1]++;
+	}
+
+	uint32_t offset = 0;
+	for (int c = 0; c < clusterCount; c++)
+	{
+		uint32_t& count = grid.ranges[c * 2 + 1];
+		if (offset + count > (uint32_t)MaxClusterLightIndices)
+		{
+			grid.overflowed += (int)count;
+			count = 0; // <-- cluster goes unlit rather than overrunning the index buffer
+		}
+		offset += count;
+		grid.ranges[c * 2 + 0] = offset;
+	}
+	grid.indices.resize(offset);
+
+	for (int i = lightCount - 1; i >= 0; i--)
+	{
+		int b[4];
+		clusterBounds(lights[i], b);
+		for (int cy = b[1]; cy <= b[3]; cy++)
+		{
+			for (int cx = b[0]; cx <= b[2]; cx++)
+			{
+				uint32_t* range = &grid.ranges[(cy * LightClusters + cx) * 2];
+				if (range[1] == 0) continue;
+				grid.indices[--range[0]] = (uint32_t)i;
+			}
+		}
+	}
+}
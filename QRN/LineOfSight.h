@@ -0,0 +1,290 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <immintrin.h>
+
+#include "Grid.h"
+#include "DistanceField.h"
+#include "Parallel.h"
+#include "Cpu.h"
+
+/*=============================================================================+/
+								 Line of Sight
+/+=============================================================================*/
+
+/*
+	"Can A see B" for whole arrays of segments at once, same answer as SegmentClear. Targets
+	within the viewer's distance field clearance are visible outright; the rest go through
+	an any-hit version of the DDACheck stepping, four segments per SSE step, or eight with
+	AVX2, which also gathers the occupancy words in one instruction. Any hit settles a lane,
+	nothing else about the hit is needed.
+	Results are one bit per segment; threads take whole blocks of 32 bit words so none share
+	an output word.
+*/
+
+constexpr int SightBlock = 1024;   // <-- segments per parallel task, a multiple of 32
+static_assert(OccupancyRowWords == 16, "SightRange shifts by 4 for the row word offset");
+
+struct SightBatch
+{
+	std::vector<float> ax, ay;      // <-- viewers
+	std::vector<float> bx, by;      // <-- targets
+	std::vector<uint32_t> visible;  // <-- bit i & 31 of word i / 32, filled by CheckSight
+
+	// metrics from the last CheckSight
+	double lastMs = 0.0;
+	double queriesPerSecond = 0.0;
+
+	int Count() const { return (int)ax.size(); }
+
+	void Clear()
+	{
+		ax.clear(); ay.clear(); bx.clear(); by.clear();
+	}
+
+	void Add(float fromX, float fromY, float toX, float toY)
+	{
+		ax.push_back(fromX);
+		ay.push_back(fromY);
+		bx.push_back(toX);
+		by.push_back(toY);
+	}
+
+	bool Visible(int i) const
+	{
+		return (visible[i >> 5] >> (i & 31)) & 1u;
+	}
+};
+
+// One segment's DDA state, as in CastRay.
+struct SightRay
+{
+	float sideX, sideY;
+	float deltaX, deltaY;
+	float length;
+	int x, y;
+	int stepX, stepY;
+};
+
+// Scalar setup for one segment. Returns 1 or 0 when that already settles it, -1 when ray
+// needs stepping.
+inline int StartSight(const OccupancyBits& bits, const DistanceField& field, float ax, float ay, float bx, float by, SightRay& ray)
+{
+	// off the map is solid, and an endpoint's own tile is always crossed; past this check
+	// every point on the segment is non-negative, so truncating is flooring
+	auto inside = [](float v) { return v >= 0.0f && v < (float)MapSize; };
+	if (!inside(ax) || !inside(ay) || !inside(bx) || !inside(by)) return 0;
+	float dx = bx - ax;
+	float dy = by - ay;
+	float length = std::sqrt(dx * dx + dy * dy);
+	if (length == 0.0f) return !IsOccupied(bits, (int)ax, (int)ay);
+	dx /= length;
+	dy /= length;
+
+	// everything within the viewer's clearance is open, which settles most short queries
+	ray.x = (int)ax;
+	ray.y = (int)ay;
+	if (field.Clearance(ray.x, ray.y) >= length) return 1;
+	if (IsOccupied(bits, ray.x, ray.y)) return 0;
+	ray.stepX = dx > 0.0f ? 1 : -1;
+	ray.stepY = dy > 0.0f ? 1 : -1;
+	ray.deltaX = dx != 0.0f ? std::abs(1.0f / dx) : INFINITY;
+	ray.deltaY = dy != 0.0f ? std::abs(1.0f / dy) : INFINITY;
+	ray.sideX = dx != 0.0f ? (dx > 0.0f ? (float)(ray.x + 1) - ax : ax - (float)ray.x) * ray.deltaX : INFINITY;
+	ray.sideY = dy != 0.0f ? (dy > 0.0f ? (float)(ray.y + 1) - ay : ay - (float)ray.y) * ray.deltaY : INFINITY;
+	ray.length = length;
+	return -1;
+}
+
+// Visibility of segments [first, last). Four lanes step in lockstep; whenever one settles it
+// is refilled with the next unsettled segment, so short segments never wait on long ones.
+inline void SightRangeSse2(const OccupancyBits& bits, const DistanceField& field, SightBatch& batch, int first, int last)
+{
+	alignas(16) float sideX[4], sideY[4], deltaX[4], deltaY[4], length[4];
+	alignas(16) int32_t x[4], y[4], stepX[4], stepY[4];
+	int query[4];
+	int next = first;
+
+	auto settle = [&](int i, bool visible)
+	{
+		if (visible) batch.visible[i >> 5] |= 1u << (i & 31);
+	};
+	auto refill = [&](int lane)
+	{
+		SightRay ray;
+		while (next < last)
+		{
+			int i = next++;
+			int result = StartSight(bits, field, batch.ax[i], batch.ay[i], batch.bx[i], batch.by[i], ray);
+			if (result >= 0) { settle(i, result == 1); continue; }
+			sideX[lane] = ray.sideX; sideY[lane] = ray.sideY;
+			deltaX[lane] = ray.deltaX; deltaY[lane] = ray.deltaY;
+			length[lane] = ray.length;
+			x[lane] = ray.x; y[lane] = ray.y;
+			stepX[lane] = ray.stepX; stepY[lane] = ray.stepY;
+			query[lane] = i;
+			return;
+		}
+		// nothing left: park the lane where it never moves
+		sideX[lane] = sideY[lane] = INFINITY;
+		deltaX[lane] = deltaY[lane] = length[lane] = 0.0f;
+		x[lane] = y[lane] = stepX[lane] = stepY[lane] = 0;
+		query[lane] = -1;
+	};
+	for (int lane = 0; lane < 4; lane++) refill(lane);
+
+	while (true)
+	{
+		int live = 0;
+		for (int lane = 0; lane < 4; lane++) live |= (query[lane] >= 0) << lane;
+		if (!live) break;
+
+		__m128 vSideX = _mm_load_ps(sideX), vSideY = _mm_load_ps(sideY);
+		__m128 vDeltaX = _mm_load_ps(deltaX), vDeltaY = _mm_load_ps(deltaY);
+		__m128 vLength = _mm_load_ps(length);
+		__m128i vX = _mm_load_si128((const __m128i*)x), vY = _mm_load_si128((const __m128i*)y);
+		__m128i vStepX = _mm_load_si128((const __m128i*)stepX), vStepY = _mm_load_si128((const __m128i*)stepY);
+		const __m128i tileMask = _mm_set1_epi32(MapSize - 1);
+		const __m128i bitMask = _mm_set1_epi32(31);
+		alignas(16) int32_t word[4], bit[4];
+		int reached, finished;
+		do
+		{
+			__m128 alongX = _mm_cmplt_ps(vSideX, vSideY);
+			__m128 at = _mm_or_ps(_mm_and_ps(alongX, vSideX), _mm_andnot_ps(alongX, vSideY));
+			vSideX = _mm_add_ps(vSideX, _mm_and_ps(alongX, vDeltaX));
+			vSideY = _mm_add_ps(vSideY, _mm_andnot_ps(alongX, vDeltaY));
+			vX = _mm_add_epi32(vX, _mm_and_si128(_mm_castps_si128(alongX), vStepX));
+			vY = _mm_add_epi32(vY, _mm_andnot_si128(_mm_castps_si128(alongX), vStepY));
+
+			// past the end wins over whatever tile that step lands in, as in CastRay
+			reached = _mm_movemask_ps(_mm_cmpge_ps(at, vLength));
+
+			// word and bit of every lane's tile, no bounds checks: a lane still short of its end
+			// is on the map, and one past it only needs a harmless read, so wrap into range
+			__m128i wrappedX = _mm_and_si128(vX, tileMask);
+			__m128i wrappedY = _mm_and_si128(vY, tileMask);
+			_mm_store_si128((__m128i*)word, _mm_add_epi32(_mm_slli_epi32(wrappedY, 4), _mm_srli_epi32(wrappedX, 5)));
+			_mm_store_si128((__m128i*)bit, _mm_and_si128(wrappedX, bitMask));
+			int hit = 0;
+			for (int lane = 0; lane < 4; lane++) hit |= (int)((bits[word[lane]] >> bit[lane]) & 1u) << lane;
+			finished = (reached | hit) & live;
+		} while (!finished);
+
+		_mm_store_ps(sideX, vSideX); _mm_store_ps(sideY, vSideY);
+		_mm_store_si128((__m128i*)x, vX); _mm_store_si128((__m128i*)y, vY);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if (!(finished & (1 << lane))) continue;
+			settle(query[lane], (reached >> lane) & 1);
+			refill(lane);
+		}
+	}
+}
+
+// SightRangeSse2 eight lanes wide, with the tile lookup gathered instead of done per lane.
+inline void SightRangeAvx2(const OccupancyBits& bits, const DistanceField& field, SightBatch& batch, int first, int last)
+{
+	alignas(32) float sideX[8], sideY[8], deltaX[8], deltaY[8], length[8];
+	alignas(32) int32_t x[8], y[8], stepX[8], stepY[8];
+	int query[8];
+	int next = first;
+
+	auto settle = [&](int i, bool visible)
+	{
+		if (visible) batch.visible[i >> 5] |= 1u << (i & 31);
+	};
+	auto refill = [&](int lane)
+	{
+		SightRay ray;
+		while (next < last)
+		{
+			int i = next++;
+			int result = StartSight(bits, field, batch.ax[i], batch.ay[i], batch.bx[i], batch.by[i], ray);
+			if (result >= 0) { settle(i, result == 1); continue; }
+			sideX[lane] = ray.sideX; sideY[lane] = ray.sideY;
+			deltaX[lane] = ray.deltaX; deltaY[lane] = ray.deltaY;
+			length[lane] = ray.length;
+			x[lane] = ray.x; y[lane] = ray.y;
+			stepX[lane] = ray.stepX; stepY[lane] = ray.stepY;
+			query[lane] = i;
+			return;
+		}
+		sideX[lane] = sideY[lane] = INFINITY;
+		deltaX[lane] = deltaY[lane] = length[lane] = 0.0f;
+		x[lane] = y[lane] = stepX[lane] = stepY[lane] = 0;
+		query[lane] = -1;
+	};
+	for (int lane = 0; lane < 8; lane++) refill(lane);
+
+	const __m256i tileMask = _mm256_set1_epi32(MapSize - 1);
+	const __m256i bitMask = _mm256_set1_epi32(31);
+	const __m256i one = _mm256_set1_epi32(1);
+	while (true)
+	{
+		int live = 0;
+		for (int lane = 0; lane < 8; lane++) live |= (query[lane] >= 0) << lane;
+		if (!live) break;
+
+		__m256 vSideX = _mm256_load_ps(sideX), vSideY = _mm256_load_ps(sideY);
+		__m256 vDeltaX = _mm256_load_ps(deltaX), vDeltaY = _mm256_load_ps(deltaY);
+		__m256 vLength = _mm256_load_ps(length);
+		__m256i vX = _mm256_load_si256((const __m256i*)x), vY = _mm256_load_si256((const __m256i*)y);
+		__m256i vStepX = _mm256_load_si256((const __m256i*)stepX), vStepY = _mm256_load_si256((const __m256i*)stepY);
+		int reached, finished;
+		do
+		{
+			__m256 alongX = _mm256_cmp_ps(vSideX, vSideY, _CMP_LT_OQ);
+			__m256 at = _mm256_blendv_ps(vSideY, vSideX, alongX);
+			vSideX = _mm256_add_ps(vSideX, _mm256_and_ps(alongX, vDeltaX));
+			vSideY = _mm256_add_ps(vSideY, _mm256_andnot_ps(alongX, vDeltaY));
+			vX = _mm256_add_epi32(vX, _mm256_and_si256(_mm256_castps_si256(alongX), vStepX));
+			vY = _mm256_add_epi32(vY, _mm256_andnot_si256(_mm256_castps_si256(alongX), vStepY));
+
+			reached = _mm256_movemask_ps(_mm256_cmp_ps(at, vLength, _CMP_GE_OQ));
+
+			// same wrap as the SSE version keeps every gathered index on the map
+			__m256i wrappedX = _mm256_and_si256(vX, tileMask);
+			__m256i wrappedY = _mm256_and_si256(vY, tileMask);
+			__m256i word = _mm256_add_epi32(_mm256_slli_epi32(wrappedY, 4), _mm256_srli_epi32(wrappedX, 5));
+			__m256i words = _mm256_i32gather_epi32((const int*)bits.data(), word, 4);
+			__m256i bit = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(wrappedX, bitMask)), one);
+			int hit = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(bit, one)));
+			finished = (reached | hit) & live;
+		} while (!finished);
+
+		_mm256_store_ps(sideX, vSideX); _mm256_store_ps(sideY, vSideY);
+		_mm256_store_si256((__m256i*)x, vX); _mm256_store_si256((__m256i*)y, vY);
+		for (int lane = 0; lane < 8; lane++)
+		{
+			if (!(finished & (1 << lane))) continue;
+			settle(query[lane], (reached >> lane) & 1);
+			refill(lane);
+		}
+	}
+}
+
+using SightRangeFn = void (*)(const OccupancyBits&, const DistanceField&, SightBatch&, int, int);
+inline const IsaKernel<SightRangeFn> sightRangeKernel({ SightRangeSse2, nullptr, SightRangeAvx2, nullptr });
+
+inline void SightRange(const OccupancyBits& bits, const DistanceField& field, SightBatch& batch, int first, int last)
+{
+	sightRangeKernel.Get()(bits, field, batch, first, last);
+}
+
+// Fills batch.visible for every segment in the batch.
+inline void CheckSight(const OccupancyBits& bits, const DistanceField& field, SightBatch& batch)
+{
+	auto start = std::chrono::steady_clock::now();
+	int count = batch.Count();
+	batch.visible.assign((count + 31) / 32, 0u);
+	ParallelFor(0, (count + SightBlock - 1) / SightBlock, [&](int block)
+	{
+		SightRange(bits, field, batch, block * SightBlock, (std::min)((block + 1) * SightBlock, count));
+	});
+	batch.lastMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	batch.queriesPerSecond = batch.lastMs > 0.0 ? count * 1000.0 / batch.lastMs : 0.0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+
+#include "Grid.h"
+
+/*=============================================================================+/
+								   Map Edits
+/+=============================================================================*/
+
+/*
+	Tiles set or cleared while the game runs (doors, destruction). Edits only record the
+	rectangle they dirtied; once a frame the rectangles are coalesced and everything derived
+	from the map is brought up to date for those rectangles alone: the GPU tile and occupancy
+	buffers, the distance field, jump table, flow field moves, lightmap chunks and the wall
+	mesh sections. Coalescing trades a few clean tiles for fewer, larger updates: nearby
+	rectangles merge when their bounding box is not much bigger than the two of them.
+*/
+
+constexpr int TileRectMergeSlack = 64;     // <-- clean tiles a merge may add
+constexpr int TileRectLimit = 64;          // <-- past this many, everything merges into one
+
+struct TileRect
+{
+	int x0, y0, x1, y1;   // <-- [x0, x1) x [y0, y1)
+
+	int Area() const { return (x1 - x0) * (y1 - y0); }
+
+	TileRect Union(const TileRect& other) const
+	{
+		return { (std::min)(x0, other.x0), (std::min)(y0, other.y0), (std::max)(x1, other.x1), (std::max)(y1, other.y1) };
+	}
+};
+
+struct MapEdits
+{
+	std::vector<TileRect> dirty;
+
+	// stats from the last Coalesce
+	int edited = 0;        // <-- rectangles recorded
+	int coalesced = 0;     // <-- rectangles left
+
+	void Touch(int x0, int y0, int x1, int y1)
+	{
+		x0 = (std::max)(x0, 0);
+		y0 = (std::max)(y0, 0);
+		x1 = (std::min)(x1, MapSize);
+		y1 = (std::min)(y1, MapSize);
+		if (x0 < x1 && y0 < y1) dirty.push_back({ x0, y0, x1, y1 });
+	}
+
+	bool Empty() const { return dirty.empty(); }
+
+	// Merges until no pair is worth merging. Pairwise, which is fine for a frame's worth.
+	void Coalesce()
+	{
+		edited = (int)dirty.size();
+		if ((int)dirty.size() > TileRectLimit)
+		{
+			TileRect all = dirty[0];
+			for (const TileRect& rect : dirty) all = all.Union(rect);
+			dirty.assign(1, all);
+		}
+		for (bool merged = true; merged;)
+		{
+			merged = false;
+			for (size_t i = 0; i < dirty.size() && !merged; i++)
+			{
+				for (size_t j = i + 1; j < dirty.size(); j++)
+				{
+					TileRect both = dirty[i].Union(dirty[j]);
+					if (both.Area() > dirty[i].Area() + dirty[j].Area() + TileRectMergeSlack) continue;
+					dirty[i] = both;
+					dirty[j] = dirty.back();
+					dirty.pop_back();
+					merged = true;
+					break;
+				}
+			}
+		}
+		coalesced = (int)dirty.size();
+	}
+};
@@ -0,0 +1,212 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <span>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+
+#include "Grid.h"
+#include "MapEdits.h"
+#include "Epoch.h"
+
+/*=============================================================================+/
+								   Map Store
+/+=============================================================================*/
+
+/*
+	The occupancy bits as immutable versions, for reading the map from other threads while
+	it is being edited. In game the player and particle collision and the sprite column
+	rays read through it. Pathfinding does not: JPS+ also needs the JumpTable, which is
+	derived from the live map on the main thread and not versioned here.
+		- a reader pins the current version with Read() and keeps it, unchanged, for as long
+		  as the View lives; no locks, no reference counts, nothing a writer can stall
+		- a writer builds the next version off to the side (a copy of the current one plus its
+		  changes), publishes it with one atomic exchange and retires the old one
+		- retired versions go back to the pool once no thread is pinned at an epoch that
+		  could still see them (Epoch.h); a long read holds back memory, never edits
+	A version is the whole 32 KB bit map rather than a tree of chunks: copying it is a couple
+	of microseconds, and every reader keeps taking a flat OccupancyBits. Chunks of 32x32
+	tiles carry the version that last changed them, so a reader caching something per chunk
+	can tell what to redo. Writers serialize among themselves with a mutex.
+*/
+
+constexpr int MapChunkTiles = 32;
+constexpr int MapChunksPerSide = MapSize / MapChunkTiles;
+constexpr int MapChunkCount = MapChunksPerSide * MapChunksPerSide;
+
+struct TileChange
+{
+	int x, y;
+	bool wall;
+};
+
+struct MapVersion
+{
+	uint64_t number = 0;
+	OccupancyBits bits;
+	std::array<uint64_t, MapChunkCount> chunkVersions;   // <-- version that last changed each chunk
+	MapVersion* nextFree = nullptr;
+};
+
+class MapStore
+{
+public:
+	// A pinned version. Keep it on the stack of the thread that took it, and short of the
+	// next frame if memory matters: nothing retired while it lives can be reused.
+	class View
+	{
+	public:
+		~View() { Epochs().Exit(); }
+		View(const View&) = delete;
+		View& operator=(const View&) = delete;
+
+		const OccupancyBits& Bits() const { return version->bits; }
+		uint64_t Number() const { return version->number; }
+		uint64_t ChunkVersion(int cx, int cy) const { return version->chunkVersions[cy * MapChunksPerSide + cx]; }
+
+	private:
+		friend class MapStore;
+		const MapVersion* version;
+
+		explicit View(const std::atomic<MapVersion*>& current)
+		{
+			Epochs().Enter(); // <-- pin before loading, so whatever is loaded stays
+			version = current.load(std::memory_order_seq_cst);
+		}
+	};
+
+	// stats
+	uint64_t published = 0;
+	uint64_t reclaimed = 0;
+
+	MapStore() = default;
+	MapStore(const MapStore&) = delete;
+	MapStore& operator=(const MapStore&) = delete;
+
+	// Never blocks. Only valid after Reset.
+	View Read() const { return View(current); }
+
+	// Replaces the map outright, as version 1 of a new history when called first.
+	void Reset(const OccupancyBits& bits)
+	{
+		std::lock_guard lock(writer);
+		MapVersion* next = Allocate();
+		MapVersion* previous = current.load(std::memory_order_relaxed);
+		next->number = previous ? previous->number + 1 : 1;
+		next->bits = bits;
+		next->chunkVersions.fill(next->number);
+		Swap(next);
+	}
+
+	// Publishes the tiles changed; returns the new version number.
+	uint64_t Publish(std::span<const TileChange> changes)
+	{
+		std::lock_guard lock(writer);
+		MapVersion* next = Begin();
+		for (const TileChange& change : changes)
+		{
+			uint32_t& word = next->bits[change.y * OccupancyRowWords + (change.x >> 5)];
+			uint32_t bit = 1u << (change.x & 31);
+			word = change.wall ? word | bit : word & ~bit;
+			next->chunkVersions[(change.y / MapChunkTiles) * MapChunksPerSide + change.x / MapChunkTiles] = next->number;
+		}
+		Swap(next);
+		return next->number;
+	}
+
+	// Publishes the rectangles as they are in live, which the caller owns; returns the new
+	// version number.
+	uint64_t Publish(const OccupancyBits& live, std::span<const TileRect> rects)
+	{
+		std::lock_guard lock(writer);
+		MapVersion* next = Begin();
+		for (const TileRect& r : rects)
+		{
+			for (int y = r.y0; y < r.y1; y++)
+			{
+				for (int w = r.x0 >> 5; w <= (r.x1 - 1) >> 5; w++) // <-- whole words: the bits outside match already
+					next->bits[y * OccupancyRowWords + w] = live[y * OccupancyRowWords + w];
+			}
+			for (int cy = r.y0 / MapChunkTiles; cy <= (r.y1 - 1) / MapChunkTiles; cy++)
+				for (int cx = r.x0 / MapChunkTiles; cx <= (r.x1 - 1) / MapChunkTiles; cx++)
+					next->chunkVersions[cy * MapChunksPerSide + cx] = next->number;
+		}
+		Swap(next);
+		return next->number;
+	}
+
+	// Retired versions still waiting on a reader.
+	int Retired() const
+	{
+		std::lock_guard lock(writer);
+		return (int)retired.size();
+	}
+
+	// Versions allocated so far, current, retired or free.
+	int PoolVersions() const
+	{
+		std::lock_guard lock(writer);
+		return (int)pool.size();
+	}
+
+private:
+	struct RetiredVersion
+	{
+		MapVersion* version;
+		uint64_t epoch;
+	};
+
+	std::atomic<MapVersion*> current{ nullptr };
+	mutable std::mutex writer;   // <-- guards everything below; readers never take it
+	std::vector<std::unique_ptr<MapVersion>> pool;
+	std::vector<RetiredVersion> retired;
+	MapVersion* freeVersions = nullptr;
+
+	MapVersion* Allocate()
+	{
+		if (!freeVersions)
+		{
+			pool.push_back(std::make_unique<MapVersion>());
+			freeVersions = pool.back().get();
+		}
+		MapVersion* version = freeVersions;
+		freeVersions = version->nextFree;
+		return version;
+	}
+
+	MapVersion* Begin()
+	{
+		const MapVersion* previous = current.load(std::memory_order_relaxed);
+		MapVersion* next = Allocate();
+		next->number = previous->number + 1;
+		next->bits = previous->bits;
+		next->chunkVersions = previous->chunkVersions;
+		return next;
+	}
+
+	void Swap(MapVersion* next)
+	{
+		MapVersion* previous = current.exchange(next, std::memory_order_seq_cst);
+		published++;
+		if (previous) retired.push_back({ previous, Epochs().Retire() });
+		Reclaim();
+	}
+
+	// A reader pinned at an epoch past a version's retirement loaded current after the
+	// exchange, so it can't be holding that version.
+	void Reclaim()
+	{
+		uint64_t oldest = Epochs().OldestPinned();
+		auto stillPinned = std::partition(retired.begin(), retired.end(), [&](const RetiredVersion& r) { return r.epoch >= oldest; });
+		for (auto r = stillPinned; r != retired.end(); r++)
+		{
+			r->version->nextFree = freeVersions;
+			freeVersions = r->version;
+			reclaimed++;
+		}
+		retired.erase(stillPinned, retired.end());
+	}
+};
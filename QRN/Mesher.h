@@ -0,0 +1,225 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+
+#include "Grid.h"
+#include "Parallel.h"
+
+/*=============================================================================+/
+								  Wall Mesher
+/+=============================================================================*/
+
+// Walls are full height, so greedy meshing a face direction collapses to merging runs of
+// exposed faces along each boundary line; every run becomes one quad.
+
+constexpr float CeilingHeight = 4.0f; // <-- DDACheck puts the ceiling at twice the eye height
+
+struct WallVertex
+{
+	float position[3];
+	float normal[3];   // <-- points out of the wall, toward the open tile
+};
+
+struct WallQuad
+{
+	int axis;       // <-- 0: face lies on an x boundary, 1: on a y boundary
+	int side;       // <-- +1 or -1, direction of the normal along axis
+	int line;       // <-- boundary coordinate the face lies on
+	int begin;      // <-- first tile along the boundary
+	int end;        // <-- one past the last tile
+};
+
+// A wall tile has an exposed face toward (dx, dy) if that neighbour is open; the map edge
+// counts as solid so the border never gets outward faces.
+inline bool HasFace(const OccupancyBits& bits, int x, int y, int dx, int dy)
+{
+	return IsOccupied(bits, x, y) && !IsOccupied(bits, x + dx, y + dy);
+}
+
+// Merges every exposed run on one boundary line of one face direction.
+inline void MeshLine(const OccupancyBits& bits, int axis, int side, int line, std::vector<WallQuad>& quads)
+{
+	int dx = axis == 0 ? side : 0;
+	int dy = axis == 1 ? side : 0;
+	int begin = -1;
+	for (int i = 0; i <= MapSize; i++)
+	{
+		bool face = i < MapSize && (axis == 0 ? HasFace(bits, line, i, dx, dy) : HasFace(bits, i, line, dx, dy));
+		if (face && begin < 0) begin = i;
+		if (!face && begin >= 0)
+		{
+			// face of tile `line` facing +side sits on the far boundary when side is positive
+			quads.push_back({ axis, side, line + (side > 0 ? 1 : 0), begin, i });
+			begin = -1;
+		}
+	}
+}
+
+// Meshes all four face directions, one task per (direction, line), in parallel.
+// Output order is deterministic: direction major, then line.
+inline std::vector<WallQuad> MeshWalls(const OccupancyBits& bits)
+{
+	constexpr int directions = 4;
+	std::vector<std::vector<WallQuad>> lines(directions * MapSize);
+	ParallelFor(0, directions * MapSize, [&](int task)
+	{
+		int direction = task / MapSize;
+		MeshLine(bits, direction >> 1, (direction & 1) ? -1 : 1, task % MapSize, lines[task]);
+	});
+
+	size_t total = 0;
+	for (const auto& line : lines) total += line.size();
+	std::vector<WallQuad> quads;
+	quads.reserve(total);
+	for (const auto& line : lines) quads.insert(quads.end(), line.begin(), line.end());
+	return quads;
+}
+
+// Two triangles per quad, floor to ceiling.
+inline void AppendQuadVertices(const WallQuad& quad, std::vector<WallVertex>& vertices)
+{
+	float n[3] = { 0.0f, 0.0f, 0.0f };
+	n[quad.axis] = (float)quad.side;
+
+	auto corner = [&](int along, float z) -> WallVertex
+	{
+		float x = quad.axis == 0 ? (float)quad.line : (float)along;
+		float y = quad.axis == 0 ? (float)along : (float)quad.line;
+		return { { x, y, z }, { n[0], n[1], n[2] } };
+	};
+
+	WallVertex a = corner(quad.begin, 0.0f);
+	WallVertex b = corner(quad.end, 0.0f);
+	WallVertex c = corner(quad.end, CeilingHeight);
+	WallVertex d = corner(quad.begin, CeilingHeight);
+	vertices.insert(vertices.end(), { a, b, c, a, c, d });
+}
+
+// Floor and ceiling as one quad each over the whole map; walls hide what is under them.
+inline void AppendFloorAndCeiling(std::vector<WallVertex>& vertices)
+{
+	for (float z : { 0.0f, CeilingHeight })
+	{
+		float nz = z == 0.0f ? 1.0f : -1.0f;
+		float s = (float)MapSize;
+		WallVertex a = { { 0.0f, 0.0f, z }, { 0.0f, 0.0f, nz } };
+		WallVertex b = { { s, 0.0f, z }, { 0.0f, 0.0f, nz } };
+		WallVertex c = { { s, s, z }, { 0.0f, 0.0f, nz } };
+		WallVertex d = { { 0.0f, s, z }, { 0.0f, 0.0f, nz } };
+		vertices.insert(vertices.end(), { a, b, c, a, c, d });
+	}
+}
+
+constexpr int WallMeshBand = 32;                                  // <-- boundary lines per section
+constexpr int WallMeshSections = 4 * MapSize / WallMeshBand;      // <-- plus one for floor and ceiling
+
+// The wall mesh for a map that changes: quads are kept per boundary line, and the vertex
+// buffer is laid out in sections of WallMeshBand lines of one direction, each with room to
+// grow. A tile edit remeshes the lines next to it and rewrites only their sections; a
+// section that outgrows its room lays the whole buffer out again.
+// Draw with one multi draw over first / count.
+struct WallMesh
+{
+	std::vector<std::vector<WallQuad>> lines = std::vector<std::vector<WallQuad>>(4 * MapSize);
+	std::vector<WallVertex> vertices;
+	std::array<int, WallMeshSections + 1> first{};
+	std::array<int, WallMeshSections + 1> count{};
+	std::array<int, WallMeshSections + 1> capacity{};
+
+	// what changed since the last upload
+	bool relaid = false;                 // <-- everything moved, upload the whole buffer
+	std::vector<int> dirtySections;
+
+	void Build(const OccupancyBits& bits)
+	{
+		ParallelFor(0, 4 * MapSize, [&](int task) { RemeshLine(bits, task); });
+		Layout();
+	}
+
+	// After tiles in [x0, x1) x [y0, y1) changed. A face reads its tile and the neighbour it
+	// faces, so lines one past the rectangle on each side are redone.
+	void Update(const OccupancyBits& bits, int x0, int y0, int x1, int y1)
+	{
+		std::vector<int> touched;
+		for (int direction = 0; direction < 4; direction++)
+		{
+			bool alongX = (direction >> 1) == 0; // <-- axis 0 faces sit on x boundaries, one line per tile column
+			int begin = (std::max)((alongX ? x0 : y0) - 1, 0);
+			int end = (std::min)((alongX ? x1 : y1) + 1, MapSize);
+			for (int line = begin; line < end; line++) RemeshLine(bits, direction * MapSize + line);
+			for (int section = begin / WallMeshBand; section <= (end - 1) / WallMeshBand; section++)
+				touched.push_back(direction * (MapSize / WallMeshBand) + section);
+		}
+
+		for (int section : touched)
+		{
+			if (VertexCount(section) > capacity[section])
+			{
+				Layout();
+				return;
+			}
+		}
+		for (int section : touched)
+		{
+			FillSection(section);
+			if (std::find(dirtySections.begin(), dirtySections.end(), section) == dirtySections.end()) dirtySections.push_back(section);
+		}
+	}
+
+	int QuadCount() const
+	{
+		int quads = 0;
+		for (const auto& line : lines) quads += (int)line.size();
+		return quads;
+	}
+
+private:
+	void RemeshLine(const OccupancyBits& bits, int task)
+	{
+		int direction = task / MapSize;
+		lines[task].clear();
+		MeshLine(bits, direction >> 1, (direction & 1) ? -1 : 1, task % MapSize, lines[task]);
+	}
+
+	int VertexCount(int section) const
+	{
+		int quads = 0;
+		for (int line = section * WallMeshBand; line < (section + 1) * WallMeshBand; line++) quads += (int)lines[line].size();
+		return quads * 6;
+	}
+
+	void FillSection(int section)
+	{
+		thread_local std::vector<WallVertex> scratch;
+		scratch.clear();
+		for (int line = section * WallMeshBand; line < (section + 1) * WallMeshBand; line++)
+			for (const WallQuad& quad : lines[line]) AppendQuadVertices(quad, scratch);
+		std::copy(scratch.begin(), scratch.end(), vertices.begin() + first[section]);
+		count[section] = (int)scratch.size();
+	}
+
+	// Room for a quarter more than each section has now, floor and ceiling last.
+	void Layout()
+	{
+		int total = 0;
+		for (int section = 0; section < WallMeshSections; section++)
+		{
+			int vertexCount = VertexCount(section);
+			first[section] = total;
+			capacity[section] = vertexCount + vertexCount / 4 + 6 * 8;
+			total += capacity[section];
+		}
+		first[WallMeshSections] = total;
+		capacity[WallMeshSections] = count[WallMeshSections] = 12;
+		vertices.resize((size_t)total + 12);
+		for (int section = 0; section < WallMeshSections; section++) FillSection(section);
+
+		std::vector<WallVertex> floorAndCeiling;
+		AppendFloorAndCeiling(floorAndCeiling);
+		std::copy(floorAndCeiling.begin(), floorAndCeiling.end(), vertices.begin() + total);
+		relaid = true;
+		dirtySections.clear();
+	}
+};
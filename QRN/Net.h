@@ -0,0 +1,191 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+/*=============================================================================+/
+									  Net
+/+=============================================================================*/
+
+/*
+	Non-blocking UDP on the loopback interface, and bit packing for what goes over it.
+	Sockets only ever talk to 127.0.0.1: this is for running a server and its clients in one
+	process or on one machine, not for the internet (no NAT, no encryption, no MTU care).
+	Winsock starts on first use and stays up for the process.
+*/
+
+constexpr int NetPacketBytes = 16384;   // <-- largest datagram sent; loopback takes up to 64 KB
+
+inline void NetStartup()
+{
+	static const bool started = []
+	{
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0) throw std::runtime_error("WSAStartup failed");
+		return true;
+	}();
+	(void)started;
+}
+
+struct NetAddress
+{
+	sockaddr_in address{};
+
+	bool operator==(const NetAddress& other) const
+	{
+		return address.sin_port == other.address.sin_port && address.sin_addr.s_addr == other.address.sin_addr.s_addr;
+	}
+};
+
+class UdpSocket
+{
+public:
+	// Bound to 127.0.0.1:port, port 0 for any free one.
+	explicit UdpSocket(uint16_t port = 0)
+	{
+		NetStartup();
+		handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (handle == INVALID_SOCKET) throw std::runtime_error("Could not create UDP socket: " + std::to_string(WSAGetLastError()));
+
+		NetAddress bound = Loopback(port);
+		if (bind(handle, (const sockaddr*)&bound.address, sizeof(bound.address)) == SOCKET_ERROR)
+		{
+			int error = WSAGetLastError();
+			closesocket(handle);
+			throw std::runtime_error("Could not bind UDP port " + std::to_string(port) + ": " + std::to_string(error));
+		}
+
+		u_long nonBlocking = 1;
+		ioctlsocket(handle, FIONBIO, &nonBlocking);
+		int bufferBytes = 4 << 20; // <-- a server tick to many clients is a burst
+		setsockopt(handle, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferBytes, sizeof(bufferBytes));
+		setsockopt(handle, SOL_SOCKET, SO_SNDBUF, (const char*)&bufferBytes, sizeof(bufferBytes));
+	}
+	~UdpSocket() { if (handle != INVALID_SOCKET) closesocket(handle); }
+	UdpSocket(const UdpSocket&) = delete;
+	UdpSocket& operator=(const UdpSocket&) = delete;
+
+	static NetAddress Loopback(uint16_t port)
+	{
+		NetAddress loopback;
+		loopback.address.sin_family = AF_INET;
+		loopback.address.sin_port = htons(port);
+		loopback.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		return loopback;
+	}
+
+	NetAddress Address() const
+	{
+		NetAddress local;
+		int length = sizeof(local.address);
+		getsockname(handle, (sockaddr*)&local.address, &length);
+		return local;
+	}
+
+	// Returns whether the datagram left; a full send buffer drops it, as the network might.
+	bool Send(const NetAddress& to, const uint8_t* data, int bytes)
+	{
+		return sendto(handle, (const char*)data, bytes, 0, (const sockaddr*)&to.address, sizeof(to.address)) == bytes;
+	}
+
+	// One waiting datagram into data, its size returned; 0 when there is none.
+	int Receive(uint8_t* data, int capacity, NetAddress& from)
+	{
+		while (true)
+		{
+			int length = sizeof(from.address);
+			int bytes = recvfrom(handle, (char*)data, capacity, 0, (sockaddr*)&from.address, &length);
+			if (bytes >= 0) return bytes;
+			int error = WSAGetLastError();
+			if (error == WSAECONNRESET || error == WSAEMSGSIZE) continue; // <-- ICMP from a closed peer, oversized datagram: skip it
+			if (error == WSAEWOULDBLOCK) return 0;
+			throw std::runtime_error("UDP receive failed: " + std::to_string(error));
+		}
+	}
+
+private:
+	SOCKET handle = INVALID_SOCKET;
+};
+
+// Little endian bit stream into a fixed buffer. Overflow is an error: a packet that doesn't
+// fit is a bug in whoever sized it.
+class BitWriter
+{
+public:
+	BitWriter(uint8_t* data, int capacity) : data(data), capacity(capacity) {}
+
+	// The low bits of value, up to 32.
+	void Write(uint32_t value, int bits)
+	{
+		scratch |= (uint64_t)(value & (uint32_t)((1ull << bits) - 1)) << scratchBits;
+		scratchBits += bits;
+		while (scratchBits >= 8)
+		{
+			Put((uint8_t)scratch);
+			scratch >>= 8;
+			scratchBits -= 8;
+		}
+	}
+
+	void WriteBool(bool value) { Write(value, 1); }
+
+	// Pads the last byte with zeros; call once before sending.
+	int Finish()
+	{
+		if (scratchBits > 0) Put((uint8_t)scratch);
+		scratch = 0;
+		scratchBits = 0;
+		return bytes;
+	}
+
+private:
+	uint8_t* data;
+	int capacity;
+	int bytes = 0;
+	uint64_t scratch = 0;
+	int scratchBits = 0;
+
+	void Put(uint8_t byte)
+	{
+		if (bytes >= capacity) throw std::runtime_error("Packet over " + std::to_string(capacity) + " bytes");
+		data[bytes++] = byte;
+	}
+};
+
+// Reading past the end gives zeros and sets overrun, so a malformed packet can be thrown away.
+class BitReader
+{
+public:
+	BitReader(const uint8_t* data, int bytes) : data(data), bytes(bytes) {}
+
+	uint32_t Read(int bits)
+	{
+		while (scratchBits < bits)
+		{
+			if (position < bytes) scratch |= (uint64_t)data[position] << scratchBits;
+			else overrun = true;
+			position++;
+			scratchBits += 8;
+		}
+		uint32_t value = (uint32_t)(scratch & ((1ull << bits) - 1));
+		scratch >>= bits;
+		scratchBits -= bits;
+		return value;
+	}
+
+	bool ReadBool() { return Read(1) != 0; }
+
+	bool overrun = false;
+
+private:
+	const uint8_t* data;
+	int bytes;
+	int position = 0;
+	uint64_t scratch = 0;
+	int scratchBits = 0;
+};
@@ -0,0 +1,187 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <span>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include "Grid.h"
+#include "Mesher.h"
+#include "Parallel.h"
+#include "Worlds.h"
+
+/*=============================================================================+/
+								  Observations
+/+=============================================================================*/
+
+/*
+	Small first person views for agents, many cameras per tick, rendered on the CPU into one
+	contiguous buffer laid out [view][row][column], one byte of luminance per pixel.
+	Walls are full height, so the image is column coherent: one 2D ray per column gives the
+	wall's perpendicular depth, and every pixel in the column is then wall, floor or ceiling
+	by comparing that depth with the depth of the floor / ceiling plane seen through its row,
+	which depends on the row alone and is tabled once per batch. Same camera as RDR.frag and
+	WALL.vert (eye height 2, ceiling at CeilingHeight, FSQ.vert's aspect scaling).
+	Shading is a flat distance falloff with x facing walls a little darker, not the lit
+	image: enough to see structure, cheap enough for thousands of views.
+	Views are split across the job system a few at a time with ParallelFor2D.
+*/
+
+constexpr int ObservationViewsPerTask = 8;
+constexpr float ObservationFar = 256.0f;         // <-- beyond this a column shows no wall
+constexpr float ObservationEyeHeight = 2.0f;     // <-- playerHeight in LIB.glsl
+constexpr int ObservationStepBins = 256;         // <-- StepHistogramBins in QRN.cpp, the last bin is 255 and up
+
+struct ObservationCamera
+{
+	float x, y;
+	float rotorX, rotorY;  // <-- yaw as a rotor, like playerrotraw
+	int map;               // <-- index into the map list handed to RenderObservations
+};
+
+struct ObservationBatch
+{
+	int width = 64;
+	int height = 48;
+	std::vector<uint8_t> pixels;       // <-- views * height * width
+	std::vector<float> depth;          // <-- views * width, perpendicular wall depth per column
+	std::vector<uint16_t> steps;       // <-- views * width, ray steps per column, as ddaSteps counts them
+
+	// per row depth of the floor or ceiling, rebuilt when the size changes
+	std::vector<float> planeDepth;
+	std::vector<uint8_t> planeShade;
+	int planeWidth = 0, planeHeight = 0;   // <-- size the tables were built for
+
+	// scratch for RenderWorldObservations, kept so a tick doesn't allocate
+	std::vector<ObservationCamera> cameras;
+	std::vector<const OccupancyBits*> maps;
+
+	// stats from the last render; steps binned like the GPU heatmap's StepStats
+	int views = 0;
+	double lastMs = 0.0;
+	double viewsPerSecond = 0.0;
+	std::array<uint64_t, ObservationStepBins> stepHistogram{};
+	uint64_t stepSum = 0;
+	int stepMax = 0;
+
+	double MeanSteps() const { return views ? (double)stepSum / ((double)views * width) : 0.0; }
+
+	// Smallest step count at or above the given fraction of columns.
+	int StepPercentile(double fraction) const
+	{
+		uint64_t target = (uint64_t)std::ceil(fraction * (double)views * width);
+		uint64_t seen = 0;
+		for (int i = 0; i < ObservationStepBins; i++)
+		{
+			seen += stepHistogram[i];
+			if (seen >= target && seen > 0) return i;
+		}
+		return ObservationStepBins - 1;
+	}
+
+	const uint8_t* View(int view) const { return pixels.data() + (size_t)view * width * height; }
+};
+
+inline uint8_t ObservationShade(float distance, float dim)
+{
+	return (uint8_t)(255.0f * dim / (1.0f + 0.08f * distance));
+}
+
+inline void RenderObservationColumns(std::span<const ObservationCamera> cameras, std::span<const OccupancyBits* const> maps,
+	ObservationBatch& out, int x0, int x1, int view)
+{
+	const ObservationCamera& camera = cameras[view];
+	const OccupancyBits& bits = *maps[camera.map];
+	float rightX = camera.rotorX * camera.rotorX - camera.rotorY * camera.rotorY;
+	float rightY = -2.0f * camera.rotorX * camera.rotorY;
+	float forwardX = -rightY;
+	float forwardY = rightX;
+	float aspect = (float)out.height / (float)out.width;
+	float scaleX = (std::min)(1.0f, 1.0f / aspect);
+	uint8_t* image = out.pixels.data() + (size_t)view * out.width * out.height;
+
+	for (int column = x0; column < x1; column++)
+	{
+		// perpendicular depth, as in SpriteRenderer::ColumnDepths
+		float u = ((column + 0.5f) / out.width * 2.0f - 1.0f) * scaleX;
+		float dx = forwardX + rightX * u;
+		float dy = forwardY + rightY * u;
+		float length = std::sqrt(dx * dx + dy * dy);
+		int steps;
+		float t = TraceRay(bits, camera.x, camera.y, dx / length, dy / length, ObservationFar * length, &steps);
+		float wall = t / length;
+		out.depth[(size_t)view * out.width + column] = wall;
+		out.steps[(size_t)view * out.width + column] = (uint16_t)(std::min)(steps, 0xFFFF);
+
+		float hitX = camera.x + dx / length * t;
+		bool xFace = std::abs(hitX - std::round(hitX)) < 1e-3f;
+		uint8_t wallShade = t < ObservationFar * length ? ObservationShade(wall, xFace ? 0.8f : 1.0f) : 0;
+		for (int row = 0; row < out.height; row++)
+		{
+			image[(size_t)row * out.width + column] = wall <= out.planeDepth[row] ? wallShade : out.planeShade[row];
+		}
+	}
+}
+
+// Renders one view per camera; maps[camera.map] is the occupancy it looks at. Fills
+// out.pixels and out.depth, sized to cameras.size() views of out.width x out.height.
+inline void RenderObservations(std::span<const ObservationCamera> cameras, std::span<const OccupancyBits* const> maps, ObservationBatch& out)
+{
+	auto start = std::chrono::steady_clock::now();
+	int views = (int)cameras.size();
+	out.views = views;
+	out.pixels.resize((size_t)views * out.width * out.height);
+	out.depth.resize((size_t)views * out.width);
+	out.steps.resize((size_t)views * out.width);
+
+	if (out.planeWidth != out.width || out.planeHeight != out.height)
+	{
+		out.planeWidth = out.width;
+		out.planeHeight = out.height;
+		// row centers top to bottom; both planes sit CeilingHeight / 2 from the eye
+		float aspect = (float)out.height / (float)out.width;
+		float scaleY = (std::min)(1.0f, aspect);
+		out.planeDepth.resize(out.height);
+		out.planeShade.resize(out.height);
+		for (int row = 0; row < out.height; row++)
+		{
+			float v = (1.0f - (row + 0.5f) / out.height * 2.0f) * scaleY;
+			float plane = v > 0.0f ? CeilingHeight - ObservationEyeHeight : ObservationEyeHeight;
+			out.planeDepth[row] = plane / std::abs(v);
+			out.planeShade[row] = ObservationShade(out.planeDepth[row], v > 0.0f ? 0.5f : 0.65f);
+		}
+	}
+
+	ParallelFor2D(0, 0, out.width, views, out.width, ObservationViewsPerTask, [&](int x0, int y0, int x1, int y1)
+	{
+		for (int view = y0; view < y1; view++) RenderObservationColumns(cameras, maps, out, x0, x1, view);
+	});
+
+	out.stepHistogram.fill(0);
+	out.stepSum = 0;
+	out.stepMax = 0;
+	for (uint16_t steps : out.steps)
+	{
+		out.stepHistogram[(std::min)((int)steps, ObservationStepBins - 1)]++;
+		out.stepSum += steps;
+		out.stepMax = (std::max)(out.stepMax, (int)steps);
+	}
+
+	out.lastMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	out.viewsPerSecond = out.lastMs > 0.0 ? views * 1000.0 / out.lastMs : 0.0;
+}
+
+// One view per world, from its player.
+inline void RenderWorldObservations(const WorldBatch& worlds, ObservationBatch& out)
+{
+	out.maps.resize(worlds.MapCount());
+	for (int m = 0; m < worlds.MapCount(); m++) out.maps[m] = &worlds.maps[m]->bits;
+	out.cameras.resize(worlds.WorldCount());
+	for (int w = 0; w < worlds.WorldCount(); w++)
+	{
+		out.cameras[w] = { worlds.playerX[w], worlds.playerY[w], worlds.rotorX[w], worlds.rotorY[w], worlds.map[w] };
+	}
+	RenderObservations(out.cameras, out.maps, out);
+}
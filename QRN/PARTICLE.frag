@@ -0,0 +1,41 @@
+#version 450 core
+out vec4 FragColor;
+flat in float depth;
+flat in float brightness;
+layout(std430, binding = 0) readonly buffer Grid
+{
+    float values[512][512];  // height x width, only here for TileAt in LIB.glsl
+};
+layout(std430, binding = 6) readonly buffer ColumnDepth
+{
+	float columnDepth[];	// <-- nearest wall per screen column, filled with the sprites
+};
+uniform float aspectratio = 0.75;
+uniform vec2 resolution = vec2(800.0, 600.0);
+uniform uint frameCount;
+
+/*=============================================================+/
+							Functions
+/+=============================================================*/
+
+int TileAt(ivec2 maploc)
+{
+	return int(values[maploc.y][maploc.x]);
+}
+
+/*=============================================================+/
+							  Main
+/+=============================================================*/
+
+void main()
+{
+	int column = min(int(gl_FragCoord.x), columnDepth.length() - 1);
+	if (depth >= columnDepth[column]) discard;
+
+	vec2 uv = (gl_FragCoord.xy / resolution * 2.0 - 1.0) * vec2(min(1.0, 1.0/aspectratio), min(1.0, aspectratio));
+	float noise = p3DtoFloat(ivec3(vec2AsIvec2(uv), frameCount));
+
+	float tval = pow(noise, 1.0 / brightness - 1.0);
+
+	FragColor = vec4(vec3(tval), 1.0);
+}
@@ -0,0 +1,39 @@
+#version 450 core
+layout(std430, binding = 7) readonly buffer Particles
+{
+	float particleData[];	// <-- x, then y, then z, then life, particleCount floats each
+};
+flat out float depth;
+flat out float brightness;
+uniform vec2 playerpos = vec2(4.5, 4.5); // <-- is the player's position
+uniform vec2 playerrot = vec2(1.0, 0.0); // <-- is a rotor, player's yaw value as rotor
+uniform float aspectratio = 0.75;
+uniform vec2 resolution = vec2(800.0, 600.0);
+uniform int particleCount;
+
+const float playerHeight = 2.0; // <-- is the player's eye height off the ground
+
+const float nearPlane = 0.05;
+const float farPlane = 1000.0;
+const float particleSize = 0.04; // <-- world units across
+
+void main()
+{
+	vec3 position = vec3(particleData[gl_VertexID], particleData[particleCount + gl_VertexID], particleData[2 * particleCount + gl_VertexID]);
+	float life = particleData[3 * particleCount + gl_VertexID];
+
+	// same camera basis and projection as WALL.vert
+	vec3 right = vec3(playerrot.x * playerrot.x - playerrot.y * playerrot.y, -2.0 * playerrot.x * playerrot.y, 0.0);
+	vec3 forward = vec3(-right.y, right.x, 0.0);
+	vec3 up = vec3(0.0, 0.0, 1.0);
+
+	vec3 d = position - vec3(playerpos, playerHeight);
+	vec3 view = vec3(dot(d, right), dot(d, up), dot(d, forward));
+	vec2 scale = vec2(min(1.0, 1.0/aspectratio), min(1.0, aspectratio)); // <-- matches FSQ.vert
+
+	float z = (view.z * (farPlane + nearPlane) - 2.0 * farPlane * nearPlane) / (farPlane - nearPlane);
+	gl_Position = vec4(view.xy / scale, z, view.z);
+	gl_PointSize = clamp(particleSize / (max(view.z, nearPlane) * scale.y) * 0.5 * resolution.y, 1.0, 8.0);
+	depth = view.z;
+	brightness = min(life, 1.0) * 7.0 / (dot(d, d) + 6.0);	// <-- fades over its last second
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <algorithm>
+
+#include "Jobs.h"
+
+/*=============================================================================+/
+								Parallel Helpers
+/+=============================================================================*/
+
+// Calls body(i) for every i in [begin, end) on the shared job system. The range splits
+// lazily, so uneven work balances by stealing; small counts run on the calling thread.
+template <typename Body>
+void ParallelFor(int begin, int end, Body&& body)
+{
+	Jobs().For(begin, end, body);
+}
+
+// Calls body(x0, y0, x1, y1) once per tileWidth x tileHeight tile of the rectangle
+// [x0, x1) x [y0, y1), edge tiles clipped, tiles spread across the job system.
+template <typename Body>
+void ParallelFor2D(int x0, int y0, int x1, int y1, int tileWidth, int tileHeight, Body&& body)
+{
+	if (x1 <= x0 || y1 <= y0) return;
+	int tilesX = (x1 - x0 + tileWidth - 1) / tileWidth;
+	int tilesY = (y1 - y0 + tileHeight - 1) / tileHeight;
+	Jobs().For(0, tilesX * tilesY, [&](int tile)
+	{
+		int tx = x0 + (tile % tilesX) * tileWidth;
+		int ty = y0 + (tile / tilesX) * tileHeight;
+		body(tx, ty, (std::min)(tx + tileWidth, x1), (std::min)(ty + tileHeight, y1));
+	});
+}
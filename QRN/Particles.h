@@ -0,0 +1,342 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <bit>
+#include <immintrin.h>
+
+#include "Grid.h"
+#include "Hash.h"
+#include "Mesher.h"
+#include "Cpu.h"
+#include "Parallel.h"
+
+/*=============================================================================+/
+								   Particles
+/+=============================================================================*/
+
+/*
+	Dust, sparks and projectiles: points under gravity that bounce off walls, floor and
+	ceiling until their life runs out. Storage is structure of arrays, allocated once by
+	Reserve, so a tick never allocates:
+		1. blocks of particles integrate in parallel, 16 per AVX-512 step or 8 per AVX2 step
+		   (scalar where neither is there, Cpu.h); the occupancy words of all the lanes'
+		   tiles come from one gather, and each axis reverts and reflects on its own, like
+		   ResolveCircleTiles does for circles
+		2. every block writes the indices of particles that died into its own slice of dead
+		3. the dead slices are packed together and the holes filled from the live tail, so
+		   compaction costs O(dead), not O(count)
+*/
+
+constexpr int ParticleBlock = 8192;            // <-- particles per parallel task, a multiple of 16
+constexpr float ParticleGravity = -9.8f;
+constexpr float ParticleRestitution = 0.5f;    // <-- speed kept along the axis of a bounce
+static_assert(OccupancyRowWords == 16, "the particle kernels shift by 4 for the row word offset");
+
+struct ParticleSystem
+{
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> velX, velY, velZ;
+	std::vector<float> life;                   // <-- seconds left, dead at or below zero
+
+	// per block scratch, sized by Reserve
+	std::vector<uint32_t> dead;                // <-- block b writes from b * ParticleBlock
+	std::vector<int> blockDead;
+	std::vector<int> blockBounces;
+
+	int count = 0;
+
+	// stats from the last Step
+	int wallBounces = 0;
+	int died = 0;
+	double stepMs = 0.0;
+	double compactMs = 0.0;
+
+	int Count() const { return count; }
+	int Capacity() const { return (int)posX.size(); }
+
+	void Reserve(int capacity)
+	{
+		for (auto* field : { &posX, &posY, &posZ, &velX, &velY, &velZ, &life }) field->resize(capacity);
+		dead.resize(capacity);
+		blockDead.resize((capacity + ParticleBlock - 1) / ParticleBlock);
+		blockBounces.resize(blockDead.size());
+		count = (std::min)(count, capacity);
+	}
+
+	void Clear() { count = 0; }
+
+	// False when full; the caller decides whether dropping it matters.
+	bool Emit(float x, float y, float z, float vx, float vy, float vz, float lifetime)
+	{
+		if (count == Capacity()) return false;
+		posX[count] = x; posY[count] = y; posZ[count] = z;
+		velX[count] = vx; velY[count] = vy; velZ[count] = vz;
+		life[count] = lifetime;
+		count++;
+		return true;
+	}
+
+	void Step(float dt, const OccupancyBits& bits)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int blocks = (count + ParticleBlock - 1) / ParticleBlock;
+		StepFn kernel = StepKernel().Get();
+		ParallelFor(0, blocks, [&](int block)
+		{
+			int begin = block * ParticleBlock;
+			int end = (std::min)(begin + ParticleBlock, count);
+			blockDead[block] = 0;
+			blockBounces[block] = 0;
+			int i = (this->*kernel)(begin, end, dt, bits, block);
+			StepScalar(i, end, dt, bits, block);
+		});
+		wallBounces = 0;
+		for (int block = 0; block < blocks; block++) wallBounces += blockBounces[block];
+		auto stepped = std::chrono::steady_clock::now();
+		Compact(blocks);
+		stepMs = std::chrono::duration<double, std::milli>(stepped - start).count();
+		compactMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stepped).count();
+	}
+
+	static bool Solid(const OccupancyBits& bits, float x, float y)
+	{
+		if (!(x >= 0.0f && y >= 0.0f && x < (float)MapSize && y < (float)MapSize)) return true;
+		return IsOccupied(bits, (int)x, (int)y);
+	}
+
+	// Returns end, like the vector kernels return where the scalar tail picks up.
+	int StepScalar(int begin, int end, float dt, const OccupancyBits& bits, int block)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			velZ[i] += ParticleGravity * dt;
+			float x = posX[i] + velX[i] * dt;
+			float y = posY[i] + velY[i] * dt;
+			float z = posZ[i] + velZ[i] * dt;
+			if (Solid(bits, x, posY[i])) { x = posX[i]; velX[i] *= -ParticleRestitution; blockBounces[block]++; }
+			if (Solid(bits, x, y)) { y = posY[i]; velY[i] *= -ParticleRestitution; blockBounces[block]++; }
+			if (z < 0.0f) { z = -z; velZ[i] *= -ParticleRestitution; }
+			if (z > CeilingHeight) { z = 2.0f * CeilingHeight - z; velZ[i] *= -ParticleRestitution; }
+			posX[i] = x; posY[i] = y; posZ[i] = z;
+			life[i] -= dt;
+			if (life[i] <= 0.0f) dead[(size_t)block * ParticleBlock + blockDead[block]++] = (uint32_t)i;
+		}
+		return end;
+	}
+
+	// Walls as an all ones lane mask: off the map, or the tile's occupancy bit. Indices are
+	// wrapped into the map first so the gather never reads outside it.
+	static __m256 SolidAvx2(const OccupancyBits& bits, __m256 x, __m256 y)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 size = _mm256_set1_ps((float)MapSize);
+		__m256 inside = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_GE_OQ), _mm256_cmp_ps(x, size, _CMP_LT_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(y, zero, _CMP_GE_OQ), _mm256_cmp_ps(y, size, _CMP_LT_OQ)));
+		const __m256i tileMask = _mm256_set1_epi32(MapSize - 1);
+		__m256i tx = _mm256_and_si256(_mm256_cvttps_epi32(x), tileMask);
+		__m256i ty = _mm256_and_si256(_mm256_cvttps_epi32(y), tileMask);
+		__m256i word = _mm256_add_epi32(_mm256_slli_epi32(ty, 4), _mm256_srli_epi32(tx, 5));
+		__m256i words = _mm256_i32gather_epi32((const int*)bits.data(), word, 4);
+		__m256i bit = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(tx, _mm256_set1_epi32(31))), _mm256_set1_epi32(1));
+		__m256 occupied = _mm256_castsi256_ps(_mm256_cmpeq_epi32(bit, _mm256_set1_epi32(1)));
+		return _mm256_or_ps(occupied, _mm256_andnot_ps(inside, _mm256_castsi256_ps(_mm256_set1_epi32(-1))));
+	}
+
+	// 8 particles per step from begin; returns where the scalar tail picks up.
+	int StepAvx2(int begin, int end, float dt, const OccupancyBits& bits, int block)
+	{
+		const __m256 step = _mm256_set1_ps(dt);
+		const __m256 fall = _mm256_set1_ps(ParticleGravity * dt);
+		const __m256 bounce = _mm256_set1_ps(-ParticleRestitution);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 ceiling = _mm256_set1_ps(CeilingHeight);
+		const __m256 twoCeilings = _mm256_set1_ps(2.0f * CeilingHeight);
+		const __m256 signBit = _mm256_set1_ps(-0.0f);
+		int bounces = 0;
+
+		int i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 px = _mm256_loadu_ps(&posX[i]), py = _mm256_loadu_ps(&posY[i]), pz = _mm256_loadu_ps(&posZ[i]);
+			__m256 vx = _mm256_loadu_ps(&velX[i]), vy = _mm256_loadu_ps(&velY[i]);
+			__m256 vz = _mm256_add_ps(_mm256_loadu_ps(&velZ[i]), fall);
+			// no fma, so both kernels round alike
+			__m256 x = _mm256_add_ps(px, _mm256_mul_ps(vx, step));
+			__m256 y = _mm256_add_ps(py, _mm256_mul_ps(vy, step));
+			__m256 z = _mm256_add_ps(pz, _mm256_mul_ps(vz, step));
+
+			// x alone first, then y from wherever x settled
+			__m256 hitX = SolidAvx2(bits, x, py);
+			x = _mm256_blendv_ps(x, px, hitX);
+			vx = _mm256_blendv_ps(vx, _mm256_mul_ps(vx, bounce), hitX);
+			__m256 hitY = SolidAvx2(bits, x, y);
+			y = _mm256_blendv_ps(y, py, hitY);
+			vy = _mm256_blendv_ps(vy, _mm256_mul_ps(vy, bounce), hitY);
+			bounces += std::popcount((unsigned)_mm256_movemask_ps(hitX)) + std::popcount((unsigned)_mm256_movemask_ps(hitY));
+
+			// floor and ceiling reflect the overshoot
+			__m256 below = _mm256_cmp_ps(z, zero, _CMP_LT_OQ);
+			__m256 above = _mm256_cmp_ps(z, ceiling, _CMP_GT_OQ);
+			z = _mm256_blendv_ps(z, _mm256_xor_ps(z, signBit), below);
+			z = _mm256_blendv_ps(z, _mm256_sub_ps(twoCeilings, z), above);
+			vz = _mm256_blendv_ps(vz, _mm256_mul_ps(vz, bounce), _mm256_or_ps(below, above));
+
+			_mm256_storeu_ps(&posX[i], x); _mm256_storeu_ps(&posY[i], y); _mm256_storeu_ps(&posZ[i], z);
+			_mm256_storeu_ps(&velX[i], vx); _mm256_storeu_ps(&velY[i], vy); _mm256_storeu_ps(&velZ[i], vz);
+
+			__m256 remaining = _mm256_sub_ps(_mm256_loadu_ps(&life[i]), step);
+			_mm256_storeu_ps(&life[i], remaining);
+			int gone = _mm256_movemask_ps(_mm256_cmp_ps(remaining, zero, _CMP_LE_OQ));
+			while (gone)
+			{
+				int lane = std::countr_zero((unsigned)gone);
+				gone &= gone - 1;
+				dead[(size_t)block * ParticleBlock + blockDead[block]++] = (uint32_t)(i + lane);
+			}
+		}
+		blockBounces[block] += bounces;
+		return i;
+	}
+
+	// SolidAvx2 with a lane mask instead of an all ones vector.
+	static __mmask16 SolidAvx512(const OccupancyBits& bits, __m512 x, __m512 y)
+	{
+		const __m512 zero = _mm512_setzero_ps();
+		const __m512 size = _mm512_set1_ps((float)MapSize);
+		__mmask16 inside = _mm512_cmp_ps_mask(x, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(x, size, _CMP_LT_OQ)
+			& _mm512_cmp_ps_mask(y, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(y, size, _CMP_LT_OQ);
+		const __m512i tileMask = _mm512_set1_epi32(MapSize - 1);
+		__m512i tx = _mm512_and_si512(_mm512_cvttps_epi32(x), tileMask);
+		__m512i ty = _mm512_and_si512(_mm512_cvttps_epi32(y), tileMask);
+		__m512i word = _mm512_add_epi32(_mm512_slli_epi32(ty, 4), _mm512_srli_epi32(tx, 5));
+		__m512i words = _mm512_i32gather_epi32(word, (const int*)bits.data(), 4);
+		__m512i bit = _mm512_sllv_epi32(_mm512_set1_epi32(1), _mm512_and_si512(tx, _mm512_set1_epi32(31)));
+		return _mm512_test_epi32_mask(words, bit) | (__mmask16)~inside;
+	}
+
+	// StepAvx2 sixteen wide, branches as masked blends.
+	int StepAvx512(int begin, int end, float dt, const OccupancyBits& bits, int block)
+	{
+		const __m512 step = _mm512_set1_ps(dt);
+		const __m512 fall = _mm512_set1_ps(ParticleGravity * dt);
+		const __m512 bounce = _mm512_set1_ps(-ParticleRestitution);
+		const __m512 zero = _mm512_setzero_ps();
+		const __m512 ceiling = _mm512_set1_ps(CeilingHeight);
+		const __m512 twoCeilings = _mm512_set1_ps(2.0f * CeilingHeight);
+		int bounces = 0;
+
+		int i = begin;
+		for (; i + 16 <= end; i += 16)
+		{
+			__m512 px = _mm512_loadu_ps(&posX[i]), py = _mm512_loadu_ps(&posY[i]), pz = _mm512_loadu_ps(&posZ[i]);
+			__m512 vx = _mm512_loadu_ps(&velX[i]), vy = _mm512_loadu_ps(&velY[i]);
+			__m512 vz = _mm512_add_ps(_mm512_loadu_ps(&velZ[i]), fall);
+			__m512 x = _mm512_add_ps(px, _mm512_mul_ps(vx, step));
+			__m512 y = _mm512_add_ps(py, _mm512_mul_ps(vy, step));
+			__m512 z = _mm512_add_ps(pz, _mm512_mul_ps(vz, step));
+
+			__mmask16 hitX = SolidAvx512(bits, x, py);
+			x = _mm512_mask_blend_ps(hitX, x, px);
+			vx = _mm512_mask_mul_ps(vx, hitX, vx, bounce);
+			__mmask16 hitY = SolidAvx512(bits, x, y);
+			y = _mm512_mask_blend_ps(hitY, y, py);
+			vy = _mm512_mask_mul_ps(vy, hitY, vy, bounce);
+			bounces += std::popcount((unsigned)hitX) + std::popcount((unsigned)hitY);
+
+			__mmask16 below = _mm512_cmp_ps_mask(z, zero, _CMP_LT_OQ);
+			__mmask16 above = _mm512_cmp_ps_mask(z, ceiling, _CMP_GT_OQ);
+			z = _mm512_mask_sub_ps(z, below, zero, z);
+			z = _mm512_mask_sub_ps(z, above, twoCeilings, z);
+			vz = _mm512_mask_mul_ps(vz, below | above, vz, bounce);
+
+			_mm512_storeu_ps(&posX[i], x); _mm512_storeu_ps(&posY[i], y); _mm512_storeu_ps(&posZ[i], z);
+			_mm512_storeu_ps(&velX[i], vx); _mm512_storeu_ps(&velY[i], vy); _mm512_storeu_ps(&velZ[i], vz);
+
+			__m512 remaining = _mm512_sub_ps(_mm512_loadu_ps(&life[i]), step);
+			_mm512_storeu_ps(&life[i], remaining);
+			unsigned gone = _mm512_cmp_ps_mask(remaining, zero, _CMP_LE_OQ);
+			while (gone)
+			{
+				int lane = std::countr_zero(gone);
+				gone &= gone - 1;
+				dead[(size_t)block * ParticleBlock + blockDead[block]++] = (uint32_t)(i + lane);
+			}
+		}
+		blockBounces[block] += bounces;
+		return i;
+	}
+
+	using StepFn = int (ParticleSystem::*)(int, int, float, const OccupancyBits&, int);
+	static const IsaKernel<StepFn>& StepKernel()
+	{
+		static const IsaKernel<StepFn> kernel({ &ParticleSystem::StepScalar, nullptr, &ParticleSystem::StepAvx2, &ParticleSystem::StepAvx512 });
+		return kernel;
+	}
+
+	void Move(int from, int to)
+	{
+		posX[to] = posX[from]; posY[to] = posY[from]; posZ[to] = posZ[from];
+		velX[to] = velX[from]; velY[to] = velY[from]; velZ[to] = velZ[from];
+		life[to] = life[from];
+	}
+
+	// Packs the per block dead slices into one ascending list, then fills each hole, lowest
+	// first, with the last live particle. Tail entries that are dead themselves are the
+	// highest holes still unfilled, so they just shrink the range.
+	void Compact(int blocks)
+	{
+		int total = 0;
+		for (int block = 0; block < blocks; block++)
+		{
+			const uint32_t* slice = &dead[(size_t)block * ParticleBlock];
+			if (slice != &dead[total]) std::copy(slice, slice + blockDead[block], &dead[total]);
+			total += blockDead[block];
+		}
+		died = total;
+
+		int lo = 0, hi = total - 1;
+		int last = count - 1;
+		while (lo <= hi)
+		{
+			if ((int)dead[hi] == last) { hi--; last--; continue; }
+			Move(last, (int)dead[lo]);
+			lo++;
+			last--;
+		}
+		count -= total;
+	}
+};
+
+// count particles thrown out of (x, y, z) in random directions at up to speed.
+inline void EmitBurst(ParticleSystem& particles, float x, float y, float z, int count, float speed, float lifetime, uint32_t seed)
+{
+	for (int i = 0; i < count; i++)
+	{
+		uint32_t h = ChaoticHash(seed + (uint32_t)i * 0x9E3779B9u);
+		float angle = UintToUnit(h) * 6.2831853f;
+		float rise = UintToUnit(ChaoticHash(h)) * 2.0f - 1.0f;
+		float s = speed * UintToUnit(ChaoticHash(h + 1u));
+		float flat = std::sqrt(1.0f - rise * rise);
+		float t = lifetime * (0.5f + 0.5f * UintToUnit(ChaoticHash(h + 2u)));
+		if (!particles.Emit(x, y, z, std::cos(angle) * flat * s, std::sin(angle) * flat * s, rise * s, t)) return;
+	}
+}
+
+// Dust shaken loose from the ceiling over open tiles within range of (x, y).
+inline void EmitDust(ParticleSystem& particles, const OccupancyBits& bits, float x, float y, float range, int count, uint32_t seed)
+{
+	for (int i = 0; i < count; i++)
+	{
+		uint32_t h = ChaoticHash(seed + (uint32_t)i * 0x9E3779B9u);
+		float px = x + (UintToUnit(h) * 2.0f - 1.0f) * range;
+		float py = y + (UintToUnit(ChaoticHash(h)) * 2.0f - 1.0f) * range;
+		if (ParticleSystem::Solid(bits, px, py)) continue;
+		float vx = (UintToUnit(ChaoticHash(h + 1u)) - 0.5f) * 0.2f;
+		float vy = (UintToUnit(ChaoticHash(h + 2u)) - 0.5f) * 0.2f;
+		if (!particles.Emit(px, py, CeilingHeight * 0.99f, vx, vy, -0.2f, 2.0f + 4.0f * UintToUnit(ChaoticHash(h + 3u)))) return;
+	}
+}
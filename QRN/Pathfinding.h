@@ -0,0 +1,378 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+#include "Grid.h"
+#include "Parallel.h"
+
+/*=============================================================================+/
+								  Pathfinding
+/+=============================================================================*/
+
+/*
+	JPS+ (Rabin, GDC 2015) over the occupancy bits, 8-connected, diagonals may not cut corners.
+	Every open tile stores one jump distance per direction:
+		> 0   steps to the next jump point
+		<= 0  minus the steps it can go before hitting a wall
+	Each entry follows from the one a step further along the same direction, so the tables fill
+	by sweeping each line from its far end, and after a tile change only the entries whose
+	value actually moves get recomputed, walking backwards along their lines.
+*/
+
+constexpr int PathDirections = 8;
+constexpr float PathDiagonalCost = 1.41421356f;
+
+// Clockwise from -y, even entries straight, odd entries diagonal.
+constexpr int PathStep[PathDirections][2] = {
+	{ 0, -1 }, { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }
+};
+
+struct JumpTable
+{
+	std::vector<std::array<int16_t, PathDirections>> jumps = std::vector<std::array<int16_t, PathDirections>>((size_t)MapSize * MapSize);
+
+	int16_t At(int x, int y, int direction) const
+	{
+		return jumps[(size_t)y * MapSize + x][direction];
+	}
+
+	static bool Open(const OccupancyBits& bits, int x, int y)
+	{
+		return !IsOccupied(bits, x, y);
+	}
+
+	static bool CanStep(const OccupancyBits& bits, int x, int y, int direction)
+	{
+		int dx = PathStep[direction][0];
+		int dy = PathStep[direction][1];
+		if (!Open(bits, x + dx, y + dy)) return false;
+		return (direction & 1) == 0 || (Open(bits, x + dx, y) && Open(bits, x, y + dy)); // <-- no corner cutting
+	}
+
+	// True if a search travelling along direction that arrives on (x, y) has to stop there.
+	bool IsJumpPoint(const OccupancyBits& bits, int x, int y, int direction) const
+	{
+		if (direction & 1)
+		{
+			// diagonal: stop wherever either straight component leads to a jump point
+			return At(x, y, (direction + 7) & 7) > 0 || At(x, y, (direction + 1) & 7) > 0;
+		}
+		// straight: a side blocked beside the previous tile but open beside this one is a forced neighbour
+		int px = x - PathStep[direction][0];
+		int py = y - PathStep[direction][1];
+		for (int side : { (direction + 2) & 7, (direction + 6) & 7 })
+		{
+			int sx = PathStep[side][0];
+			int sy = PathStep[side][1];
+			if (!Open(bits, px + sx, py + sy) && Open(bits, x + sx, y + sy)) return true;
+		}
+		return false;
+	}
+
+	// Jump distance of (x, y) toward direction, given the entry one step further along is current.
+	int16_t Compute(const OccupancyBits& bits, int x, int y, int direction) const
+	{
+		if (!Open(bits, x, y) || !CanStep(bits, x, y, direction)) return 0;
+		int nx = x + PathStep[direction][0];
+		int ny = y + PathStep[direction][1];
+		if (IsJumpPoint(bits, nx, ny, direction)) return 1;
+		int16_t next = At(nx, ny, direction);
+		return next > 0 ? next + 1 : next - 1;
+	}
+
+	void Generate(const OccupancyBits& bits)
+	{
+		// straight directions first, diagonals read them; one task per (direction, line)
+		for (int parity : { 0, 1 })
+		{
+			constexpr int lines = 2 * MapSize - 1;
+			ParallelFor(0, 4 * lines, [&](int task)
+			{
+				int direction = (task / lines) * 2 + parity;
+				int line = task % lines;
+				if ((direction & 1) == 0 && line >= MapSize) return; // <-- straight directions have MapSize lines
+				SweepLine(bits, direction, line);
+			});
+		}
+	}
+
+	// Recomputes every entry along one line of direction, starting from its far end.
+	void SweepLine(const OccupancyBits& bits, int direction, int line)
+	{
+		int dx = PathStep[direction][0];
+		int dy = PathStep[direction][1];
+		int x, y;
+		if (dy == 0)      { x = 0; y = line; }
+		else if (dx == 0) { x = line; y = 0; }
+		else if (dx == dy){ int c = line - (MapSize - 1); x = (std::max)(c, 0); y = (std::max)(-c, 0); } // <-- x - y = c
+		else              { x = (std::min)(line, MapSize - 1); y = line - x; }                         // <-- x + y = line
+
+		// run off the far end, then fill walking back
+		auto inside = [](int x, int y) { return (unsigned)x < (unsigned)MapSize && (unsigned)y < (unsigned)MapSize; };
+		while (inside(x + dx, y + dy)) { x += dx; y += dy; }
+		for (; inside(x, y); x -= dx, y -= dy)
+		{
+			jumps[(size_t)y * MapSize + x][direction] = Compute(bits, x, y, direction);
+		}
+	}
+
+	// Brings the tables up to date after tiles in [x0, x1) x [y0, y1) changed. An entry reads
+	// only tiles within one step of itself, so entries on the rectangle padded by one are
+	// recomputed; from there a change travels backwards along its line, and a straight change
+	// also reaches the diagonals either side that read it.
+	void Update(const OccupancyBits& bits, int x0, int y0, int x1, int y1)
+	{
+		x0 = (std::max)(x0 - 1, 0);
+		y0 = (std::max)(y0 - 1, 0);
+		x1 = (std::min)(x1 + 1, MapSize);
+		y1 = (std::min)(y1 + 1, MapSize);
+
+		std::vector<std::array<int, 2>> seeds[PathDirections];
+		for (int direction = 0; direction < PathDirections; direction++)
+			for (int y = y0; y < y1; y++)
+				for (int x = x0; x < x1; x++)
+					seeds[direction].push_back({ x, y });
+
+		std::vector<std::array<int, 2>> stack;
+		for (int parity : { 0, 1 })
+		{
+			for (int direction = parity; direction < PathDirections; direction += 2)
+			{
+				int dx = PathStep[direction][0];
+				int dy = PathStep[direction][1];
+				auto settle = [&](int x, int y)
+				{
+					int16_t& entry = jumps[(size_t)y * MapSize + x][direction];
+					int16_t value = Compute(bits, x, y, direction);
+					if (value == entry) return;
+					entry = value;
+
+					int px = x - dx;
+					int py = y - dy;
+					if ((unsigned)px < (unsigned)MapSize && (unsigned)py < (unsigned)MapSize) stack.push_back({ px, py });
+					if (parity == 0)
+					{
+						for (int diagonal : { (direction + 1) & 7, (direction + 7) & 7 })
+						{
+							int qx = x - PathStep[diagonal][0];
+							int qy = y - PathStep[diagonal][1];
+							if ((unsigned)qx < (unsigned)MapSize && (unsigned)qy < (unsigned)MapSize) seeds[diagonal].push_back({ qx, qy });
+						}
+					}
+				};
+
+				// far end first, so every seed reads an already settled entry ahead of it
+				std::sort(seeds[direction].begin(), seeds[direction].end(), [&](const auto& a, const auto& b)
+				{
+					return a[0] * dx + a[1] * dy > b[0] * dx + b[1] * dy;
+				});
+				stack.clear();
+				for (const auto& [x, y] : seeds[direction]) settle(x, y);
+				while (!stack.empty())
+				{
+					auto [x, y] = stack.back();
+					stack.pop_back();
+					settle(x, y);
+				}
+			}
+		}
+	}
+};
+
+/*
+	Queries. A search touches per tile state for the whole map, so each worker borrows one
+	scratch block from a pool for its share of a batch; generation stamps make "clearing" it
+	between queries free.
+*/
+
+struct PathQuery
+{
+	int startX, startY;
+	int goalX, goalY;
+};
+
+struct PathResult
+{
+	std::vector<std::array<int, 2>> waypoints;   // <-- start, every jump point taken, goal; straight or 45 degree runs between
+	float cost = 0.0f;
+	int expanded = 0;
+	bool found = false;
+};
+
+struct PathScratch
+{
+	std::vector<float> g = std::vector<float>((size_t)MapSize * MapSize);
+	std::vector<int32_t> parent = std::vector<int32_t>((size_t)MapSize * MapSize);
+	std::vector<uint8_t> arrived = std::vector<uint8_t>((size_t)MapSize * MapSize); // <-- direction travelled to reach the tile
+	std::vector<uint32_t> stamp = std::vector<uint32_t>((size_t)MapSize * MapSize, 0);
+	std::vector<std::pair<float, int32_t>> open;
+	uint32_t generation = 0;
+
+	void Begin()
+	{
+		if (++generation == 0)
+		{
+			std::fill(stamp.begin(), stamp.end(), 0);
+			generation = 1;
+		}
+		open.clear();
+	}
+};
+
+struct PathScratchPool
+{
+	std::mutex lock;
+	std::vector<std::unique_ptr<PathScratch>> free;
+
+	std::unique_ptr<PathScratch> Acquire()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (!free.empty())
+			{
+				std::unique_ptr<PathScratch> scratch = std::move(free.back());
+				free.pop_back();
+				return scratch;
+			}
+		}
+		return std::make_unique<PathScratch>(); // <-- only until the pool has one per worker
+	}
+
+	void Release(std::unique_ptr<PathScratch> scratch)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		free.push_back(std::move(scratch));
+	}
+};
+
+inline float OctileDistance(int dx, int dy)
+{
+	dx = std::abs(dx);
+	dy = std::abs(dy);
+	return (float)(std::max)(dx, dy) + (PathDiagonalCost - 1.0f) * (float)(std::min)(dx, dy);
+}
+
+inline void FindPath(const JumpTable& table, const OccupancyBits& bits, const PathQuery& query, PathScratch& scratch, PathResult& result)
+{
+	result.waypoints.clear();
+	result.cost = 0.0f;
+	result.expanded = 0;
+	result.found = false;
+	if (IsOccupied(bits, query.startX, query.startY) || IsOccupied(bits, query.goalX, query.goalY)) return;
+
+	scratch.Begin();
+	int start = query.startY * MapSize + query.startX;
+	int goal = query.goalY * MapSize + query.goalX;
+	auto heapOrder = [](const auto& a, const auto& b) { return a.first > b.first; };
+	auto relax = [&](int tile, int from, int direction, float g)
+	{
+		if (scratch.stamp[tile] == scratch.generation && scratch.g[tile] <= g) return;
+		scratch.stamp[tile] = scratch.generation;
+		scratch.g[tile] = g;
+		scratch.parent[tile] = from;
+		scratch.arrived[tile] = (uint8_t)direction;
+		float h = OctileDistance(query.goalX - tile % MapSize, query.goalY - tile / MapSize);
+		scratch.open.push_back({ g + h, tile });
+		std::push_heap(scratch.open.begin(), scratch.open.end(), heapOrder);
+	};
+	relax(start, -1, PathDirections, 0.0f); // <-- "arrived" from nowhere, so every direction gets searched
+
+	while (!scratch.open.empty())
+	{
+		std::pop_heap(scratch.open.begin(), scratch.open.end(), heapOrder);
+		auto [f, tile] = scratch.open.back();
+		scratch.open.pop_back();
+		int x = tile % MapSize;
+		int y = tile / MapSize;
+		float g = scratch.g[tile];
+		if (f > g + OctileDistance(query.goalX - x, query.goalY - y) + 1e-4f) continue; // <-- stale entry
+		result.expanded++;
+
+		if (tile == goal)
+		{
+			result.found = true;
+			result.cost = g;
+			for (int at = goal; at >= 0; at = scratch.parent[at]) result.waypoints.push_back({ at % MapSize, at / MapSize });
+			std::reverse(result.waypoints.begin(), result.waypoints.end());
+			return;
+		}
+
+		// straight arrivals search ahead, both diagonals ahead and both sides (forced
+		// neighbours); diagonal arrivals search ahead and both straight components
+		int arrived = scratch.arrived[tile];
+		int first = 0, last = PathDirections - 1;
+		if (arrived < PathDirections)
+		{
+			int spread = (arrived & 1) ? 1 : 2;
+			first = arrived - spread;
+			last = arrived + spread;
+		}
+
+		int goalDX = query.goalX - x;
+		int goalDY = query.goalY - y;
+		for (int turn = first; turn <= last; turn++)
+		{
+			int direction = turn & 7;
+			int dx = PathStep[direction][0];
+			int dy = PathStep[direction][1];
+			int jump = table.At(x, y, direction);
+			int reach = std::abs(jump);
+
+			if ((direction & 1) == 0)
+			{
+				// goal on this line and no further than the jump or the wall
+				int along = dx != 0 ? goalDX * dx : goalDY * dy;
+				bool onLine = dx != 0 ? goalDY == 0 : goalDX == 0;
+				if (onLine && along > 0 && along <= reach)
+				{
+					relax(goal, tile, direction, g + (float)along);
+				}
+				else if (jump > 0)
+				{
+					relax(tile + (dy * MapSize + dx) * jump, tile, direction, g + (float)jump);
+				}
+			}
+			else
+			{
+				// goal in this quadrant and its row or column crossed before the jump ends:
+				// stop where the diagonal lines up with it and carry on straight from there
+				bool quadrant = goalDX * dx > 0 && goalDY * dy > 0;
+				int rows = std::abs(goalDY);
+				int columns = std::abs(goalDX);
+				if (quadrant && (rows <= reach || columns <= reach))
+				{
+					int steps = (std::min)(rows, columns);
+					relax(tile + (dy * MapSize + dx) * steps, tile, direction, g + PathDiagonalCost * (float)steps);
+				}
+				else if (jump > 0)
+				{
+					relax(tile + (dy * MapSize + dx) * jump, tile, direction, g + PathDiagonalCost * (float)jump);
+				}
+			}
+		}
+	}
+}
+
+// Answers a whole batch in a few contiguous shares per worker, so a share of long paths gets
+// balanced by stealing the others; each share takes its own pooled scratch.
+// results is resized to match queries; its waypoint vectors keep their capacity across calls.
+inline void FindPaths(const JumpTable& table, const OccupancyBits& bits, const std::vector<PathQuery>& queries,
+	std::vector<PathResult>& results, PathScratchPool& pool)
+{
+	results.resize(queries.size());
+	int count = (int)queries.size();
+	int shares = (std::min)((std::max)(count, 1), Jobs().Workers() * 4);
+	ParallelFor(0, shares, [&](int share)
+	{
+		int first = (int)((long long)count * share / shares);
+		int last = (int)((long long)count * (share + 1) / shares);
+		std::unique_ptr<PathScratch> scratch = pool.Acquire();
+		for (int i = first; i < last; i++) FindPath(table, bits, queries[i], *scratch, results[i]);
+		pool.Release(std::move(scratch));
+	});
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+
+/*=============================================================================+/
+								   Profiler
+/+=============================================================================*/
+
+/*
+	Scoped CPU timing that is cheap enough to leave in release builds, dumped as Chrome
+	trace JSON (chrome://tracing, ui.perfetto.dev) on demand.
+		- PROFILE_SCOPE("name") times the rest of the enclosing block; name must be a string
+		  literal or otherwise outlive the profiler
+		- every thread records into its own ring buffer, written only by that thread and read
+		  by the dump, so recording takes no locks; old events are overwritten
+		- GPU passes are timed with GL_TIME_ELAPSED queries in QRN.cpp and land here through
+		  RecordGpuEvent on their own track
+	When profiling is off a scope costs one relaxed load.
+*/
+
+constexpr int ProfileRingSize = 1 << 16;      // <-- events kept per thread
+
+struct ProfileEvent
+{
+	const char* name;
+	uint64_t startNs;
+	uint64_t durationNs;
+};
+
+struct ProfileRing
+{
+	ProfileEvent events[ProfileRingSize];
+	std::atomic<uint64_t> written{ 0 };        // <-- total ever recorded; the slot is written % size
+	uint32_t threadId = 0;
+	std::string threadName;
+	ProfileRing* next = nullptr;               // <-- registry list, never unlinked
+
+	void Record(const char* name, uint64_t startNs, uint64_t durationNs)
+	{
+		uint64_t n = written.load(std::memory_order_relaxed);
+		events[n % ProfileRingSize] = { name, startNs, durationNs };
+		written.store(n + 1, std::memory_order_release);
+	}
+};
+
+class Profiler
+{
+public:
+	std::atomic<bool> enabled{ true };
+
+	Profiler() { gpu.threadName = "GPU"; }
+
+	uint64_t Now() const
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	// This thread's ring, made on first use. Rings live as long as the process, so a
+	// dump can still read one whose thread has exited.
+	ProfileRing& ThreadRing(const char* name = nullptr)
+	{
+		thread_local ProfileRing* ring = nullptr;
+		if (!ring)
+		{
+			ring = new ProfileRing();
+			ring->threadId = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+			ring->threadName = name ? name : "thread " + std::to_string(ring->threadId);
+			ProfileRing* head = rings.load(std::memory_order_relaxed);
+			do ring->next = head;
+			while (!rings.compare_exchange_weak(head, ring, std::memory_order_release, std::memory_order_relaxed));
+		}
+		return *ring;
+	}
+
+	// Names the calling thread's track; call before it records anything.
+	void NameThread(const char* name) { ThreadRing(name); }
+
+	void RecordGpuEvent(const char* name, uint64_t startNs, uint64_t durationNs)
+	{
+		gpu.Record(name, startNs, durationNs);
+	}
+
+	// Writes everything still in the rings as Chrome trace JSON. Returns false if the file
+	// couldn't be written. A thread lapping its ring mid dump can leave a few events with
+	// mismatched times, never a bad name: pointers are written whole.
+	bool WriteChromeTrace(const std::string& path)
+	{
+		std::ofstream out(path);
+		if (!out) return false;
+		std::lock_guard lock(dumpMutex); // <-- only one dump at a time, recording carries on
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		auto writeRing = [&](const ProfileRing& ring, uint32_t tid)
+		{
+			out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+				<< ",\"args\":{\"name\":\"" << ring.threadName << "\"}}";
+			first = false;
+			uint64_t written = ring.written.load(std::memory_order_acquire);
+			uint64_t begin = written > ProfileRingSize ? written - ProfileRingSize : 0;
+			for (uint64_t i = begin; i < written; i++)
+			{
+				const ProfileEvent& e = ring.events[i % ProfileRingSize];
+				out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+					<< ",\"ts\":" << e.startNs / 1000.0 << ",\"dur\":" << e.durationNs / 1000.0 << "}";
+			}
+		};
+		for (const ProfileRing* ring = rings.load(std::memory_order_acquire); ring; ring = ring->next) writeRing(*ring, ring->threadId);
+		writeRing(gpu, GpuTrack);
+		out << "\n]}\n";
+		return (bool)out;
+	}
+
+private:
+	static constexpr uint32_t GpuTrack = 1000000; // <-- tid for the GPU row, away from real threads
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	std::atomic<ProfileRing*> rings{ nullptr };
+	std::atomic<uint32_t> nextThreadId{ 0 };
+	std::mutex dumpMutex;
+	ProfileRing gpu;
+};
+
+inline Profiler& Profile()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+struct ProfileScope
+{
+	const char* name;
+	uint64_t start;
+
+	explicit ProfileScope(const char* name) : name(name), start(Profile().enabled.load(std::memory_order_relaxed) ? Profile().Now() : ~0ull) {}
+	~ProfileScope()
+	{
+		if (start == ~0ull) return;
+		Profile().ThreadRing().Record(name, start, Profile().Now() - start);
+	}
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
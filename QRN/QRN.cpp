@@ -3,17 +3,43 @@
 #include <functional>
 #include <array>
 #include <string>
+#include <winsock2.h> // <-- before Windows.h, which would pull in the old winsock.h
 #include <Windows.h>
 #include <vector>
 #include <unordered_map>
 #include <math.h>
 #include <numbers>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <new>
+#include <malloc.h>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "resource.h"
+#include "Grid.h"
+#include "Mesher.h"
+#include "Lightmap.h"
+#include "Lights.h"
+#include "DistanceField.h"
+#include "Collision.h"
+#include "Entities.h"
+#include "Pathfinding.h"
+#include "FlowField.h"
+#include "LineOfSight.h"
+#include "Sprites.h"
+#include "Particles.h"
+#include "Worlds.h"
+#include "Observations.h"
+#include "Replication.h"
+#include "Snapshots.h"
+#include "MapEdits.h"
+#include "MapStore.h"
+#include "FrameMemory.h"
+#include "Profile.h"
+#include "DebugLog.h"
 #include <algorithm>
 /*=============================================================================+/
 									TODO List
@@ -35,15 +61,30 @@
 /+=============================================================================*/
 
 GLuint tilemaploc;
+GLuint occupancyloc;
 
 GLuint playerposloc;
 GLuint playerrotloc;
 GLuint aspectratioloc;
 GLuint framecountloc;
+GLuint stepheatmaploc;
+
+GLuint tileplayerposloc;
+GLuint tileplayerrotloc;
+GLuint tileaspectratioloc;
+GLuint tileframecountloc;
+GLuint tilestepheatmaploc;
+
+GLuint wallplayerposloc;
+GLuint wallplayerrotloc;
+GLuint wallaspectratioloc;
+GLuint wallresolutionloc;
+GLuint wallframecountloc;
 
 std::array<double, 2> playerposraw = { 4.5, 4.5 };
 std::array<double, 2> playerrotraw = { 1.0, 0.0 }; // rotor representing no rotation
 float aspectratio = 1.0f;
+std::array<int, 2> framebufferSize = { 800, 600 };
 
 std::array<double, 2> lastMousePos = { 400.0f, 300.0f };
 
@@ -55,12 +96,146 @@ double deltaTime = 0.05; // <-- independant of framerate.
 std::array<double, 2> movementInput = { 0.0, 0.0 }; // x is strafe, y is forward
 double movementSpeed = 4.0; // units per second
 
-std::array<float, 512*512> mapdata;
+TileMap mapdata;
+CowRegion mapPages(mapdata.data(), sizeof(TileMap)); // <-- copy on write pages of mapdata for save states
+WorldSnapshot quickSave; // <-- F5 saves, F9 loads
+MapEdits mapEdits; // <-- tiles changed since the last ApplyMapEdits
+void SetTile(int x, int y, bool wall); // <-- with ApplyMapEdits, under Map Edits
+OccupancyBits occupancy; // <-- one bit per tile, mirrors mapdata for the compute renderer
+MapStore mapStore; // <-- published versions of occupancy, for reading off the main thread
+DistanceField distanceField; // <-- for collision early outs and sphere tracing
+JumpTable jumpTable; // <-- JPS+ jump distances for NPC pathfinding
+PathScratchPool pathScratch;
+FlowFieldCache flowFields; // <-- shared crowd navigation, one field per goal tile
+GLuint distancefieldloc;
+
+enum class RenderMode
+{
+    Fragment,   // <-- full screen triangle, DDA per fragment
+    Compute,    // <-- 16x16 pixel tiles, DDA per invocation against a shared memory map cache
+    Raster,     // <-- greedy meshed wall quads, depth tested, shaded with the DDA hit conventions
+};
+RenderMode renderMode = RenderMode::Fragment;
+bool stepHeatmap = false; // <-- H: fragment and compute paths show DDA iterations per pixel instead
 
 double playerRadius = 0.95;
 
+bool strictFrameAllocations = false; // <-- --strict-alloc: a steady state frame that allocates is an error
+LogSeverity glLogSeverity = LogSeverity::Low; // <-- --gl-log <notification|low|medium|high>: quietest GL message shown
+std::string traceFile = "qrn_trace.json"; // <-- where P (and --trace on exit) writes the profile
+
 unsigned int frameCount;
 
+/*=============================================================================+/
+	                           Allocation Tracking
+/+=============================================================================*/
+
+// Replacements for the global allocation functions, so the window can count heap traffic
+// per frame (FrameMemory.h). Everything still goes to malloc / free underneath.
+void* operator new(size_t bytes)
+{
+    CountAllocation(bytes);
+    if (void* p = std::malloc(bytes ? bytes : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t bytes, std::align_val_t alignment)
+{
+    CountAllocation(bytes);
+    if (void* p = _aligned_malloc(bytes ? bytes : 1, (size_t)alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+    CountAllocation(bytes);
+    return std::malloc(bytes ? bytes : 1);
+}
+
+void* operator new[](size_t bytes) { return operator new(bytes); }
+void* operator new[](size_t bytes, std::align_val_t alignment) { return operator new(bytes, alignment); }
+void* operator new[](size_t bytes, const std::nothrow_t& tag) noexcept { return operator new(bytes, tag); }
+
+void operator delete(void* p) noexcept { if (p) { CountFree(); std::free(p); } }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete(void* p, std::align_val_t) noexcept { if (p) { CountFree(); _aligned_free(p); } }
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete[](void* p, size_t, std::align_val_t alignment) noexcept { operator delete(p, alignment); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+
+/*=============================================================================+/
+	                              GPU Profiling
+/+=============================================================================*/
+
+// GL_TIME_ELAPSED queries around whole passes, read back once the GPU is done with them so
+// the frame never waits. Elapsed queries can't nest, so this only wraps top level passes,
+// and the benchmarks that run their own queries turn it off. The GPU track places each
+// pass at its CPU submit time with the measured GPU duration; there is no clock sync.
+constexpr int GpuTimerQueries = 64;     // <-- passes in flight, several frames' worth
+
+struct GpuTimers
+{
+    bool enabled = true;
+    GLuint queries[GpuTimerQueries] = {};
+    const char* names[GpuTimerQueries] = {};
+    uint64_t submitted[GpuTimerQueries] = {};
+    int oldest = 0;     // <-- first query still waiting on a result
+    int pending = 0;    // <-- queries ended but not yet collected
+    int active = -1;    // <-- the one between Begin and End, if any
+
+    void Create() { glGenQueries(GpuTimerQueries, queries); }
+
+    void Begin(const char* name)
+    {
+        active = -1;
+        if (!enabled || !Profile().enabled.load(std::memory_order_relaxed) || pending == GpuTimerQueries) return;
+        active = (oldest + pending) % GpuTimerQueries;
+        names[active] = name;
+        submitted[active] = Profile().Now();
+        glBeginQuery(GL_TIME_ELAPSED, queries[active]);
+    }
+
+    void End()
+    {
+        if (active < 0) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        pending++;
+        active = -1;
+    }
+
+    // Hands finished queries to the profiler, in order, stopping at the first one the GPU
+    // hasn't got to yet.
+    void Collect()
+    {
+        while (pending > 0)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &elapsed);
+            Profile().RecordGpuEvent(names[oldest], submitted[oldest], elapsed);
+            oldest = (oldest + 1) % GpuTimerQueries;
+            pending--;
+        }
+    }
+} gpuTimers;
+
+// CPU scope plus a GPU timer over the same block.
+struct GpuScope
+{
+    ProfileScope cpu;
+    explicit GpuScope(const char* name) : cpu(name) { gpuTimers.Begin(name); }
+    ~GpuScope() { gpuTimers.End(); }
+    GpuScope(const GpuScope&) = delete;
+    GpuScope& operator=(const GpuScope&) = delete;
+};
+#define PROFILE_GPU_SCOPE(name) GpuScope PROFILE_CONCAT(gpuScope, __LINE__)(name)
+
 /*=============================================================================+/
 	                            Utility Functions
 /+=============================================================================*/
@@ -123,6 +298,7 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    framebufferSize = { width, height };
     aspectratio = (float)height / (float)width;
     mouseSensitivity = BaseSensitivity / (double)max(height, width);
 }
@@ -150,6 +326,68 @@ std::unordered_map<int, std::function<void()>> onPressFunctions =
     {GLFW_KEY_D, []()
     {
         movementInput[0] += 1.0;
+    }},
+    {GLFW_KEY_1, []()
+    {
+        renderMode = RenderMode::Fragment;
+    }},
+    {GLFW_KEY_2, []()
+    {
+        renderMode = RenderMode::Compute;
+    }},
+    {GLFW_KEY_3, []()
+    {
+        renderMode = RenderMode::Raster;
+    }},
+    {GLFW_KEY_H, []()
+    {
+        stepHeatmap = !stepHeatmap;
+        if (stepHeatmap && renderMode == RenderMode::Raster) std::cout << "Step heatmap: rasterized walls don't march rays, switch to fragment (1) or compute (2)" << std::endl;
+    }},
+    {GLFW_KEY_F5, []()
+    {
+        AllocationExemption exempt; // <-- the page pool grows on the first saves
+        auto start = std::chrono::steady_clock::now();
+        quickSave.Capture(mapPages, playerposraw, playerrotraw, nullptr);
+        std::cout << "Quick save: " << mapPages.capturedPages << " map pages copied, "
+            << std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() << " us" << std::endl;
+    }},
+    {GLFW_KEY_F9, []()
+    {
+        if (quickSave.map.Empty()) return;
+        AllocationExemption exempt; // <-- the restored page list and dirty rectangles grow on the first loads
+        auto start = std::chrono::steady_clock::now();
+        int pages = quickSave.Restore(mapPages, playerposraw, playerrotraw, nullptr);
+        constexpr int pageRows = (int)(SnapshotPageBytes / (MapSize * sizeof(float)));
+        for (int page : mapPages.restored) mapEdits.Touch(0, page * pageRows, MapSize, (page + 1) * pageRows);
+        std::cout << "Quick load: " << pages << " map pages restored, "
+            << std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() << " us" << std::endl;
+    }},
+    {GLFW_KEY_F, []()
+    {
+        bool fixed = cpuRayMode.load() == CpuRayMode::Float;
+        cpuRayMode = fixed ? CpuRayMode::Fixed : CpuRayMode::Float;
+        std::cout << "CPU rays: " << (fixed ? "32.32 fixed point" : "float") << std::endl;
+    }},
+    {GLFW_KEY_E, []()
+    {
+        // the tile a step and a half ahead; not the border, and not one the player stands in
+        std::array<double, 2> forward = getForward();
+        int x = (int)std::floor(playerposraw[0] + forward[0] * 1.5);
+        int y = (int)std::floor(playerposraw[1] + forward[1] * 1.5);
+        if (x <= 0 || y <= 0 || x >= MapSize - 1 || y >= MapSize - 1) return;
+        double nearestX = std::clamp(playerposraw[0], (double)x, (double)x + 1.0);
+        double nearestY = std::clamp(playerposraw[1], (double)y, (double)y + 1.0);
+        double dx = playerposraw[0] - nearestX, dy = playerposraw[1] - nearestY;
+        if (dx * dx + dy * dy < playerRadius * playerRadius) return;
+        AllocationExemption exempt; // <-- the dirty list grows on the first edits
+        SetTile(x, y, !IsWallValue(mapdata[y * MapSize + x]));
+    }},
+    {GLFW_KEY_P, []()
+    {
+        AllocationExemption exempt; // <-- dumping on request is not the frame allocating
+        if (Profile().WriteChromeTrace(traceFile)) std::cout << "Profile written to " << traceFile << std::endl;
+        else std::cerr << "Could not write profile to " << traceFile << std::endl;
     }}
 };
 std::unordered_map<int, std::function<void()>> onReleaseFunctions = 
@@ -192,6 +430,39 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 								  Window Stuffs
 /+==============================================================================*/
 
+// GL debug callback: classifies and hands off to the log thread (DebugLog.h), never writes.
+void APIENTRY gl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+    GLsizei length, const GLchar* message, const void* userParam)
+{
+    const char* sourceName = "other";
+    switch (source)
+    {
+    case GL_DEBUG_SOURCE_API: sourceName = "api"; break;
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: sourceName = "window system"; break;
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceName = "shader compiler"; break;
+    case GL_DEBUG_SOURCE_THIRD_PARTY: sourceName = "third party"; break;
+    case GL_DEBUG_SOURCE_APPLICATION: sourceName = "application"; break;
+    }
+    const char* typeName = "other";
+    switch (type)
+    {
+    case GL_DEBUG_TYPE_ERROR: typeName = "error"; break;
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: typeName = "deprecated"; break;
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: typeName = "undefined behavior"; break;
+    case GL_DEBUG_TYPE_PORTABILITY: typeName = "portability"; break;
+    case GL_DEBUG_TYPE_PERFORMANCE: typeName = "performance"; break;
+    case GL_DEBUG_TYPE_MARKER: typeName = "marker"; break;
+    }
+    LogSeverity level = LogSeverity::Notification;
+    switch (severity)
+    {
+    case GL_DEBUG_SEVERITY_HIGH: level = LogSeverity::High; break;
+    case GL_DEBUG_SEVERITY_MEDIUM: level = LogSeverity::Medium; break;
+    case GL_DEBUG_SEVERITY_LOW: level = LogSeverity::Low; break;
+    }
+    GlLog().Post(id, level, sourceName, typeName, message, length);
+}
+
 GLuint VAO;
 struct Window
 {
@@ -201,6 +472,8 @@ struct Window
         int width = 800;
         int height = 600;
 		std::array<double, 4> clearColor = { 0.1, 0.2, 0.3, 1.0 };
+        bool maximize = true;
+        int warmupFrames = 120; // <-- frames before heap allocations count against steady state
         std::function<void()> onUpdate;
         std::function<void()> onRender;
 		Window* self = nullptr;
@@ -236,11 +509,10 @@ struct Window
         }
 
         // debugging error handling
+        GlLog().minSeverity = glLogSeverity;
+        GlLog().Start(std::cerr);
         glEnable(GL_DEBUG_OUTPUT);
-        glDebugMessageCallback([](GLenum source, GLenum type, GLuint id, GLenum severity,
-            GLsizei length, const GLchar* message, const void* userParam) {
-                std::cerr << "GL Debug: " << message << std::endl;
-            }, nullptr);
+        glDebugMessageCallback(gl_debug_callback, nullptr);
 
         // create and bind VAO
 		glGenVertexArrays(1, &VAO);
@@ -255,7 +527,13 @@ struct Window
 		glfwSetFramebufferSizeCallback(context, framebuffer_size_callback);
         glfwSetKeyCallback(context, key_callback);
 		// maximize window AFTER setting framebuffer size callback
-		glfwMaximizeWindow(context);
+		if (info.maximize) glfwMaximizeWindow(context);
+        else
+        {
+            int width, height;
+            glfwGetFramebufferSize(context, &width, &height);
+            framebuffer_size_callback(context, width, height);
+        }
 
         // hide and capture cursor
         glfwSetInputMode(context, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -265,13 +543,48 @@ struct Window
 
     ~Window()
     {
+        glDebugMessageCallback(nullptr, nullptr);
+        GlLog().Stop(); // <-- flushes what is queued and the last summary
         glfwDestroyWindow(context);
         glfwTerminate();
 	}
 
+    // steady state heap tracking, see FrameMemory.h
+    FrameAllocations lastAllocations;
+    uint64_t frameIndex = 0;
+    uint64_t allocatingFrames = 0;
+    double lastAllocationReport = -1.0;
+
+    // Called once per rendered frame: drops the frame arena, then checks the heap traffic
+    // since the last frame. Reports at most once a second; throws under --strict-alloc.
+    void EndFrame()
+    {
+        {
+            AllocationExemption exempt; // <-- growing the arena is a one off; the overflow that forced it already counted
+            FrameMemory().Reset();
+        }
+        GlLog().EndFrame();
+        FrameAllocations now = FrameAllocations::Snapshot();
+        FrameAllocations frame = now - lastAllocations;
+        lastAllocations = now;
+        if (++frameIndex <= (uint64_t)info.warmupFrames || frame.allocations == 0) return;
+
+        allocatingFrames++;
+        if (strictFrameAllocations)
+        {
+            throw std::runtime_error("heap allocation in steady state frame " + std::to_string(frameIndex));
+        }
+        double time = glfwGetTime();
+        if (time - lastAllocationReport < 1.0) return;
+        lastAllocationReport = time;
+        std::cerr << "Frame " << frameIndex << ": " << frame.allocations << " heap allocations (" << frame.bytes
+            << " bytes), " << allocatingFrames << " allocating frames since warm up" << std::endl;
+    }
+
     void operator () ()
     {
         double frametime = 0.0;
+        lastAllocations = FrameAllocations::Snapshot();
         // Update loop
         while (!glfwWindowShouldClose(context)) {
             if (glfwGetKey(context, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -281,14 +594,29 @@ struct Window
 			double currentTime = glfwGetTime();
 			deltaTime = currentTime - lastTime;
 
-            if(info.onUpdate) info.onUpdate();
+            if(info.onUpdate)
+            {
+                PROFILE_SCOPE("onUpdate");
+                info.onUpdate();
+            }
 
 			lastTime = currentTime;
 			frametime += deltaTime;
             if(frametime < (1.0 / fps)) continue;
-			if(info.onRender) info.onRender();
-			glfwSwapBuffers(context);
-            glFinish();
+			if(info.onRender)
+            {
+                PROFILE_SCOPE("onRender");
+                info.onRender();
+            }
+            {
+                PROFILE_SCOPE("glfwSwapBuffers");
+                glfwSwapBuffers(context);
+            }
+            {
+                PROFILE_SCOPE("glFinish");
+                glFinish();
+            }
+            EndFrame();
 			frametime -= 1.0 / fps;
         }
     }
@@ -314,22 +642,32 @@ struct Shader
 {
     unsigned int Type;
 	int RCID;
+    std::vector<int> Includes; // <-- resources spliced in right after the #version line, in order
 
-	Shader(unsigned int type, int rcid) : Type(type), RCID(rcid) {}
+	Shader(unsigned int type, int rcid, std::vector<int> includes = {}) : Type(type), RCID(rcid), Includes(includes) {}
 
     unsigned int Compile() const
     {
         std::string source = TextFromResource(RCID);
+
+        // the #version line has to stay first, so includes go between it and the rest of the file
+        size_t versionEnd = source.find('\n', source.find("#version"));
+        versionEnd = (versionEnd == std::string::npos) ? source.size() : versionEnd + 1;
+        std::vector<std::string> parts = { source.substr(0, versionEnd) };
+        for (int include : Includes) parts.push_back(TextFromResource(include) + "\n");
+        parts.push_back(source.substr(versionEnd));
+        std::vector<const char*> srcs;
+        for (const auto& part : parts) srcs.push_back(part.c_str());
+
         unsigned int shader = glCreateShader(Type);
-        const char* src = source.c_str();
-        glShaderSource(shader, 1, &src, nullptr);
+        glShaderSource(shader, (GLsizei)srcs.size(), srcs.data(), nullptr);
         glCompileShader(shader);
         int success;
         char infoLog[512];
         glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
         if (!success) {
             glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-            std::cout << (Type == GL_VERTEX_SHADER ? "Vertex" : "Fragment")
+            std::cout << (Type == GL_VERTEX_SHADER ? "Vertex" : Type == GL_COMPUTE_SHADER ? "Compute" : "Fragment")
                 << " Shader Compilation Failed:\n" << infoLog << std::endl;
         }
         return shader;
@@ -388,9 +726,90 @@ struct ShaderProgram
 							  Shader deffinitions
 /+=============================================================================*/
 
+// DDA step heatmap (H): the fragment and compute paths count DDACheck iterations per pixel
+// into a histogram, read back here a frame late so it never waits on the GPU, and reported
+// as mean / p99 / max steps per ray once a second. Raster mode has no rays to count.
+constexpr int StepHistogramBins = 256; // <-- stepHistogramBins in RDR.frag and RDR.comp, the last bin is 255 and up
+
+struct StepStats // <-- std430 StepStats in RDR.frag and RDR.comp, binding 8
+{
+    uint32_t sumLow;    // <-- the sum is 64 bits in two words, 32 overflow at 4K with long rays
+    uint32_t sumHigh;
+    uint32_t max;
+    uint32_t histogram[StepHistogramBins];
+};
+
+struct StepStatsTotals
+{
+    uint64_t rays = 0;
+    uint64_t sum = 0;
+    uint32_t max = 0;
+    uint64_t histogram[StepHistogramBins] = {};
+
+    void Add(const StepStats& frame)
+    {
+        for (int i = 0; i < StepHistogramBins; i++)
+        {
+            histogram[i] += frame.histogram[i];
+            rays += frame.histogram[i];
+        }
+        sum += (uint64_t)frame.sumHigh << 32 | frame.sumLow;
+        max = (std::max)(max, frame.max);
+    }
+
+    double Mean() const { return rays ? (double)sum / (double)rays : 0.0; }
+
+    // Smallest step count at or above the given fraction of rays.
+    int Percentile(double fraction) const
+    {
+        uint64_t target = (uint64_t)std::ceil(fraction * (double)rays);
+        uint64_t seen = 0;
+        for (int i = 0; i < StepHistogramBins; i++)
+        {
+            seen += histogram[i];
+            if (seen >= target && seen > 0) return i;
+        }
+        return StepHistogramBins - 1;
+    }
+
+    void Print(const char* label) const
+    {
+        int p99 = Percentile(0.99);
+        std::cout << label << "  " << rays << " rays  mean " << Mean() << "  p99 " << p99
+            << (p99 == StepHistogramBins - 1 ? "+" : "") << "  max " << max << " steps/ray" << std::endl;
+    }
+};
+
+GLuint stepstatsloc;
+bool stepStatsPending = false;      // <-- the buffer holds a frame that hasn't been read yet
+double stepStatsInterval = 1.0;     // <-- seconds between reports
+double lastStepStatsReport = 0.0;
+StepStats stepStatsFrame;
+StepStatsTotals stepStatsTotals;
+
+// Folds in the last heatmap frame and clears the buffer for this one. The window's glFinish
+// means the previous frame is done by now, so the read doesn't stall.
+void CollectStepStats()
+{
+    if (stepStatsPending)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT); // <-- shader atomics to a buffer read
+        glGetNamedBufferSubData(stepstatsloc, 0, sizeof(StepStats), &stepStatsFrame);
+        stepStatsTotals.Add(stepStatsFrame);
+    }
+    glClearNamedBufferData(stepstatsloc, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    stepStatsPending = true;
+
+    double time = glfwGetTime();
+    if (time - lastStepStatsReport < stepStatsInterval) return;
+    lastStepStatsReport = time;
+    if (stepStatsTotals.rays > 0) stepStatsTotals.Print("DDA steps");
+    stepStatsTotals = {};
+}
+
 // Main rendering shader
 Shader vertex(GL_VERTEX_SHADER, IDR_RCDATA1);
-Shader fragment(GL_FRAGMENT_SHADER, IDR_RCDATA2);
+Shader fragment(GL_FRAGMENT_SHADER, IDR_RCDATA2, { IDR_RCDATA5 });
 ShaderProgram shaderProgram({
 	.Shaders = { vertex, fragment },
     .onBuild = []()
@@ -399,6 +818,10 @@ ShaderProgram shaderProgram({
         playerrotloc = glGetUniformLocation(shaderProgram.SELF, "playerrot");
         aspectratioloc = glGetUniformLocation(shaderProgram.SELF, "aspectratio");
         framecountloc = glGetUniformLocation(shaderProgram.SELF, "frameCount");
+        stepheatmaploc = glGetUniformLocation(shaderProgram.SELF, "stepHeatmap");
+        glCreateBuffers(1, &stepstatsloc);
+        glNamedBufferStorage(stepstatsloc, sizeof(StepStats), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, stepstatsloc);
         frameCount = (unsigned int)(std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::system_clock::now().time_since_epoch()
         ).count()) & (GLuint)(-1);
@@ -409,6 +832,9 @@ ShaderProgram shaderProgram({
 		glUniform2f(playerrotloc, (float)playerrotraw[0], (float)playerrotraw[1]);
 		glUniform1f(aspectratioloc, aspectratio);
         glUniform1ui(framecountloc, frameCount++);
+        glUniform1i(stepheatmaploc, stepHeatmap);
+        if (stepHeatmap) CollectStepStats();
+        else stepStatsPending = false;
         glClear(GL_COLOR_BUFFER_BIT);
 		glDrawArrays(GL_TRIANGLES, 0, 3);
     }
@@ -420,6 +846,7 @@ ShaderProgram mapGenProgram({
     .Shaders = { mapGenShader },
     .onBuild = []()
     {
+        PROFILE_SCOPE("map generation");
         glGenBuffers(1, &tilemaploc);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, tilemaploc);
         
@@ -437,17 +864,1343 @@ ShaderProgram mapGenProgram({
         }
         std::memcpy(mapdata.data(), gpuData, 512 * 512 * sizeof(float));
         glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        mapPages.TouchAll();
+
+        // everything derived from the occupancy bits, side by side on the job system; GL calls
+        // stay on this thread, after the graph is done
+        JobGraph derive;
+        int pack = derive.Add([] { PROFILE_SCOPE("pack occupancy"); PackOccupancy(mapdata, occupancy); });
+        derive.Add([] { PROFILE_SCOPE("distance field"); distanceField.Generate(occupancy); }, { pack });
+        derive.Add([] { PROFILE_SCOPE("jump table"); jumpTable.Generate(occupancy); }, { pack });
+        derive.Add([] { PROFILE_SCOPE("flow fields"); flowFields.Reset(occupancy); }, { pack });
+        derive.Run(Jobs());
+        mapStore.Reset(occupancy);
+
+        // bit packed copy for the compute renderer, binding point 1
+        glGenBuffers(1, &occupancyloc);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, occupancyloc);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(occupancy), occupancy.data(), GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, occupancyloc);
+
+        // distance field, texture unit 2
+        glCreateTextures(GL_TEXTURE_2D, 1, &distancefieldloc);
+        glTextureStorage2D(distancefieldloc, 1, GL_R32F, MapSize, MapSize);
+        glTextureSubImage2D(distancefieldloc, 0, 0, 0, MapSize, MapSize, GL_RED, GL_FLOAT, distanceField.distances.data());
+        glBindTextureUnit(2, distancefieldloc);
     }
 	});
 
+// Tiled compute renderer, alternative to the fragment shader path
+GLuint tileframeloc = 0;    // <-- rgba8 texture the compute shader writes into
+GLuint tileframefbo = 0;    // <-- read framebuffer used to blit it to the window
+std::array<int, 2> tileframeSize = { 0, 0 };
+Shader tileRenderShader(GL_COMPUTE_SHADER, IDR_RCDATA4, { IDR_RCDATA5 });
+ShaderProgram tileRenderProgram({
+    .Shaders = { tileRenderShader },
+    .onBuild = []()
+    {
+        tileplayerposloc = glGetUniformLocation(tileRenderProgram.SELF, "playerpos");
+        tileplayerrotloc = glGetUniformLocation(tileRenderProgram.SELF, "playerrot");
+        tileaspectratioloc = glGetUniformLocation(tileRenderProgram.SELF, "aspectratio");
+        tileframecountloc = glGetUniformLocation(tileRenderProgram.SELF, "frameCount");
+        tilestepheatmaploc = glGetUniformLocation(tileRenderProgram.SELF, "stepHeatmap");
+        glCreateFramebuffers(1, &tileframefbo);
+    },
+    .onInvoke = []()
+    {
+        // (re)allocate the target whenever the window changes size
+        if (tileframeSize != framebufferSize)
+        {
+            if (tileframeloc) glDeleteTextures(1, &tileframeloc);
+            glCreateTextures(GL_TEXTURE_2D, 1, &tileframeloc);
+            glTextureStorage2D(tileframeloc, 1, GL_RGBA8, framebufferSize[0], framebufferSize[1]);
+            glNamedFramebufferTexture(tileframefbo, GL_COLOR_ATTACHMENT0, tileframeloc, 0);
+            tileframeSize = framebufferSize;
+        }
+
+        glUniform2f(tileplayerposloc, (float)playerposraw[0], (float)playerposraw[1]);
+        glUniform2f(tileplayerrotloc, (float)playerrotraw[0], (float)playerrotraw[1]);
+        glUniform1f(tileaspectratioloc, aspectratio);
+        glUniform1ui(tileframecountloc, frameCount++);
+        glUniform1i(tilestepheatmaploc, stepHeatmap);
+        if (stepHeatmap) CollectStepStats();
+        else stepStatsPending = false;
+        glBindImageTexture(0, tileframeloc, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glDispatchCompute((tileframeSize[0] + 15) / 16, (tileframeSize[1] + 15) / 16, 1);
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+        glBlitNamedFramebuffer(tileframefbo, 0,
+            0, 0, tileframeSize[0], tileframeSize[1],
+            0, 0, tileframeSize[0], tileframeSize[1],
+            GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    });
+
+// Rasterized walls: the CPU mesher turns the tile grid into merged quads once per map
+GLuint wallvao = 0;
+GLuint wallvbo = 0;
+WallMesh wallMesh;
+Shader wallVertex(GL_VERTEX_SHADER, IDR_RCDATA6);
+Shader wallFragment(GL_FRAGMENT_SHADER, IDR_RCDATA7, { IDR_RCDATA5 });
+
+// Sends whatever changed in wallMesh since the last call: everything after a fresh layout,
+// otherwise just the sections an edit rewrote.
+void UploadWallMesh()
+{
+    if (wallMesh.relaid)
+    {
+        glNamedBufferData(wallvbo, wallMesh.vertices.size() * sizeof(WallVertex), wallMesh.vertices.data(), GL_DYNAMIC_DRAW);
+    }
+    else
+    {
+        for (int section : wallMesh.dirtySections)
+        {
+            glNamedBufferSubData(wallvbo, wallMesh.first[section] * sizeof(WallVertex), wallMesh.count[section] * sizeof(WallVertex),
+                wallMesh.vertices.data() + wallMesh.first[section]);
+        }
+    }
+    wallMesh.relaid = false;
+    wallMesh.dirtySections.clear();
+}
+
+ShaderProgram wallRenderProgram({
+    .Shaders = { wallVertex, wallFragment },
+    .onBuild = []()
+    {
+        wallplayerposloc = glGetUniformLocation(wallRenderProgram.SELF, "playerpos");
+        wallplayerrotloc = glGetUniformLocation(wallRenderProgram.SELF, "playerrot");
+        wallaspectratioloc = glGetUniformLocation(wallRenderProgram.SELF, "aspectratio");
+        wallresolutionloc = glGetUniformLocation(wallRenderProgram.SELF, "resolution");
+        wallframecountloc = glGetUniformLocation(wallRenderProgram.SELF, "frameCount");
+
+        glCreateBuffers(1, &wallvbo);
+        glCreateVertexArrays(1, &wallvao);
+        glVertexArrayVertexBuffer(wallvao, 0, wallvbo, 0, sizeof(WallVertex));
+        glEnableVertexArrayAttrib(wallvao, 0);
+        glVertexArrayAttribFormat(wallvao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(WallVertex, position));
+        glVertexArrayAttribBinding(wallvao, 0, 0);
+        glEnableVertexArrayAttrib(wallvao, 1);
+        glVertexArrayAttribFormat(wallvao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(WallVertex, normal));
+        glVertexArrayAttribBinding(wallvao, 1, 0);
+        wallMesh.Build(occupancy);
+        UploadWallMesh();
+    },
+    .onInvoke = []()
+    {
+        glUniform2f(wallplayerposloc, (float)playerposraw[0], (float)playerposraw[1]);
+        glUniform2f(wallplayerrotloc, (float)playerrotraw[0], (float)playerrotraw[1]);
+        glUniform1f(wallaspectratioloc, aspectratio);
+        glUniform2f(wallresolutionloc, (float)framebufferSize[0], (float)framebufferSize[1]);
+        glUniform1ui(wallframecountloc, frameCount++);
+        glEnable(GL_DEPTH_TEST);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glBindVertexArray(wallvao);
+        glMultiDrawArrays(GL_TRIANGLES, wallMesh.first.data(), wallMesh.count.data(), WallMeshSections + 1);
+        glBindVertexArray(VAO);
+        glDisable(GL_DEPTH_TEST);
+    }
+    });
+
+/*=============================================================================+/
+								   Lightmap
+/+=============================================================================*/
+
+GLuint lightmaploc;
+LightmapBaker lightmapBaker;
+double lightmapBudgetMs = 2.0; // <-- CPU time per frame the baker may use until it is done
+std::vector<int> lightmapBaked;
+bool lightmapReportPending = false; // <-- a new map's bake prints once when done, edits' rebakes don't
+
+void CreateLightmap()
+{
+    lightmapBaker.Reset(occupancy, PlaceLights(occupancy));
+    lightmapReportPending = true;
+    glCreateTextures(GL_TEXTURE_2D, 1, &lightmaploc);
+    glTextureStorage2D(lightmaploc, 1, GL_RG8, LightmapAtlasSize, LightmapAtlasSize);
+    glTextureParameteri(lightmaploc, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(lightmaploc, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(lightmaploc, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(lightmaploc, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureSubImage2D(lightmaploc, 0, 0, 0, LightmapAtlasSize, LightmapAtlasSize, GL_RG, GL_UNSIGNED_BYTE, lightmapBaker.atlas.data());
+    glBindTextureUnit(1, lightmaploc); // <-- LIB.glsl samples unit 1
+}
+
+// Bakes whatever fits in budgetMs and uploads just the chunks that finished.
+void BakeLightmap(double budgetMs)
+{
+    if (lightmapBaker.Done()) return;
+    PROFILE_SCOPE("lightmap bake");
+    lightmapBaked.clear();
+    lightmapBaker.Bake(budgetMs, lightmapBaked);
+
+    constexpr int chunkTexels = LightmapChunkSize * LightmapTexels;
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, LightmapAtlasSize);
+    for (int chunk : lightmapBaked)
+    {
+        int x = (chunk % LightmapChunks) * chunkTexels;
+        int y = (chunk / LightmapChunks) * chunkTexels;
+        const uint8_t* texels = lightmapBaker.atlas.data() + ((size_t)y * LightmapAtlasSize + x) * 2;
+        glTextureSubImage2D(lightmaploc, 0, x, y, chunkTexels, chunkTexels, GL_RG, GL_UNSIGNED_BYTE, texels);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    if (lightmapBaker.Done() && lightmapReportPending)
+    {
+        lightmapReportPending = false;
+        std::cout << "Lightmap baked: " << lightmapBaker.chunksBaked << " chunks, "
+            << lightmapBaker.bakeMs << " ms" << std::endl;
+    }
+}
+
+/*=============================================================================+/
+								  Map Edits
+/+=============================================================================*/
+
+// Sets or clears one tile while the game runs; what depends on it catches up in ApplyMapEdits.
+void SetTile(int x, int y, bool wall)
+{
+    if ((unsigned)x >= (unsigned)MapSize || (unsigned)y >= (unsigned)MapSize) return;
+    mapdata[(size_t)y * MapSize + x] = wall ? 1.0f : 0.0f;
+    TouchTiles(mapPages, x, y, x + 1, y + 1);
+    mapEdits.Touch(x, y, x + 1, y + 1);
+}
+
+// Brings everything derived from the map up to date with the tiles changed since the last
+// call, rectangle by rectangle (MapEdits.h). Lightmap chunks are only queued; BakeLightmap
+// redoes them within its frame budget.
+void ApplyMapEdits()
+{
+    if (mapEdits.Empty()) return;
+    PROFILE_SCOPE("map edits");
+    AllocationExemption exempt; // <-- edits are one offs: the graph and the regional updates' scratch are per call
+    mapEdits.Coalesce();
+    const std::vector<TileRect>& rects = mapEdits.dirty;
+    for (const TileRect& r : rects) PackOccupancyRect(mapdata, occupancy, r.x0, r.y0, r.x1, r.y1);
+
+    JobGraph derive;
+    derive.Add([&] { PROFILE_SCOPE("distance field"); for (const TileRect& r : rects) distanceField.Update(occupancy, r.x0, r.y0, r.x1, r.y1); });
+    derive.Add([&] { PROFILE_SCOPE("jump table"); for (const TileRect& r : rects) jumpTable.Update(occupancy, r.x0, r.y0, r.x1, r.y1); });
+    derive.Add([&] { PROFILE_SCOPE("flow fields"); for (const TileRect& r : rects) flowFields.Update(occupancy, r.x0, r.y0, r.x1, r.y1); });
+    derive.Add([&] { PROFILE_SCOPE("wall mesh"); for (const TileRect& r : rects) wallMesh.Update(occupancy, r.x0, r.y0, r.x1, r.y1); });
+    derive.Run(Jobs());
+    mapStore.Publish(occupancy, rects);
+    for (const TileRect& r : rects) lightmapBaker.Invalidate(r.x0, r.y0, r.x1, r.y1);
+
+    // one upload per rectangle and buffer, from its first tile to its last; the rows in
+    // between ride along, which beats a call per row
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, MapSize);
+    for (const TileRect& r : rects)
+    {
+        size_t first = (size_t)r.y0 * MapSize + r.x0;
+        size_t last = (size_t)(r.y1 - 1) * MapSize + r.x1;
+        glNamedBufferSubData(tilemaploc, first * sizeof(float), (last - first) * sizeof(float), mapdata.data() + first);
+
+        size_t firstWord = (size_t)r.y0 * OccupancyRowWords + (r.x0 >> 5);
+        size_t lastWord = (size_t)(r.y1 - 1) * OccupancyRowWords + ((r.x1 - 1) >> 5) + 1;
+        glNamedBufferSubData(occupancyloc, firstWord * sizeof(uint32_t), (lastWord - firstWord) * sizeof(uint32_t), occupancy.data() + firstWord);
+
+        // DistanceField::Update rewrote the rectangle padded by its reach
+        int x0 = (std::max)(r.x0 - DistanceFieldMax, 0), y0 = (std::max)(r.y0 - DistanceFieldMax, 0);
+        int x1 = (std::min)(r.x1 + DistanceFieldMax, MapSize), y1 = (std::min)(r.y1 + DistanceFieldMax, MapSize);
+        glTextureSubImage2D(distancefieldloc, 0, x0, y0, x1 - x0, y1 - y0, GL_RED, GL_FLOAT,
+            distanceField.distances.data() + (size_t)y0 * MapSize + x0);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    UploadWallMesh();
+    mapEdits.dirty.clear();
+}
+
+/*=============================================================================+/
+								 Dynamic Lights
+/+=============================================================================*/
+
+GLuint lightsloc;
+GLuint lightclustersloc;
+GLuint lightindicesloc;
+int dynamicLightCount = 512;
+std::vector<DynamicLight> dynamicLights;
+LightClusterGrid lightClusterGrid;
+bool dynamicLightShadows = true;
+
+void CreateDynamicLights()
+{
+    dynamicLights = SpawnDynamicLights(occupancy, dynamicLightCount, 0x5EEDu);
+
+    glCreateBuffers(1, &lightsloc);
+    glNamedBufferStorage(lightsloc, MaxDynamicLights * sizeof(GpuLight), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glCreateBuffers(1, &lightclustersloc);
+    glNamedBufferStorage(lightclustersloc, LightClusters * LightClusters * 2 * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glCreateBuffers(1, &lightindicesloc);
+    glNamedBufferStorage(lightindicesloc, MaxClusterLightIndices * sizeof(uint32_t), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lightsloc);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lightclustersloc);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, lightindicesloc);
+    lightClusterGrid.indices.reserve(MaxClusterLightIndices); // <-- the most BinLights can ever use
+}
+
+// Per frame culling stage: animate, bin into clusters, upload the compact lists.
+void UpdateDynamicLights(double time)
+{
+    PROFILE_SCOPE("dynamic lights");
+    AnimateLights(dynamicLights, time);
+    for (DynamicLight& light : dynamicLights) light.castsShadows = dynamicLightShadows;
+    BinLights(dynamicLights, lightClusterGrid);
+
+    const auto& grid = lightClusterGrid;
+    if (!grid.gpuLights.empty()) glNamedBufferSubData(lightsloc, 0, grid.gpuLights.size() * sizeof(GpuLight), grid.gpuLights.data());
+    glNamedBufferSubData(lightclustersloc, 0, grid.ranges.size() * sizeof(uint32_t), grid.ranges.data());
+    if (!grid.indices.empty()) glNamedBufferSubData(lightindicesloc, 0, grid.indices.size() * sizeof(uint32_t), grid.indices.data());
+}
+
+/*=============================================================================+/
+								    Sprites
+/+=============================================================================*/
+
+GLuint spritesloc;
+GLuint columndepthloc;
+GLuint spriteplayerposloc;
+GLuint spriteplayerrotloc;
+GLuint spriteaspectratioloc;
+GLuint spriteresolutionloc;
+GLuint spriteframecountloc;
+int spriteCount = 4096;
+std::vector<Sprite> sprites;
+SpriteRenderer spriteRenderer;
+Shader spriteVertex(GL_VERTEX_SHADER, IDR_RCDATA8);
+Shader spriteFragment(GL_FRAGMENT_SHADER, IDR_RCDATA9, { IDR_RCDATA5 });
+
+// Culls and sorts on the CPU, uploads the survivors and the column depths, one draw call.
+ShaderProgram spriteRenderProgram({
+    .Shaders = { spriteVertex, spriteFragment },
+    .onBuild = []()
+    {
+        spriteplayerposloc = glGetUniformLocation(spriteRenderProgram.SELF, "playerpos");
+        spriteplayerrotloc = glGetUniformLocation(spriteRenderProgram.SELF, "playerrot");
+        spriteaspectratioloc = glGetUniformLocation(spriteRenderProgram.SELF, "aspectratio");
+        spriteresolutionloc = glGetUniformLocation(spriteRenderProgram.SELF, "resolution");
+        spriteframecountloc = glGetUniformLocation(spriteRenderProgram.SELF, "frameCount");
+
+        sprites = SpawnSprites(occupancy, spriteCount, 0x5B17Eu);
+        glCreateBuffers(1, &spritesloc);
+        glNamedBufferStorage(spritesloc, MaxSprites * sizeof(GpuSprite), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glCreateBuffers(1, &columndepthloc);
+        glNamedBufferStorage(columndepthloc, MaxSpriteColumns * sizeof(float), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, spritesloc);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, columndepthloc);
+    },
+    .onInvoke = []()
+    {
+        SpriteCamera camera = MakeSpriteCamera((float)playerposraw[0], (float)playerposraw[1],
+            (float)playerrotraw[0], (float)playerrotraw[1], aspectratio, framebufferSize[0]);
+        MapStore::View map = mapStore.Read(); // <-- column rays run on the job threads
+        spriteRenderer.Prepare(map.Bits(), camera, sprites);
+        const auto& columns = spriteRenderer.columnDepth;
+        glNamedBufferSubData(columndepthloc, 0, columns.size() * sizeof(float), columns.data()); // <-- particles test against it too
+        GLsizei count = (GLsizei)(std::min)(spriteRenderer.Count(), MaxSprites);
+        if (count == 0) return;
+
+        glNamedBufferSubData(spritesloc, 0, count * sizeof(GpuSprite), spriteRenderer.visible.data());
+
+        glUniform2f(spriteplayerposloc, (float)playerposraw[0], (float)playerposraw[1]);
+        glUniform2f(spriteplayerrotloc, (float)playerrotraw[0], (float)playerrotraw[1]);
+        glUniform1f(spriteaspectratioloc, aspectratio);
+        glUniform2f(spriteresolutionloc, (float)framebufferSize[0], (float)framebufferSize[1]);
+        glUniform1ui(spriteframecountloc, frameCount - 1); // <-- same noise frame as the walls behind
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+    }
+    });
+
+/*=============================================================================+/
+								   Particles
+/+=============================================================================*/
+
+GLuint particlesloc;
+GLuint particleplayerposloc;
+GLuint particleplayerrotloc;
+GLuint particleaspectratioloc;
+GLuint particleresolutionloc;
+GLuint particleframecountloc;
+GLuint particlecountloc;
+int particleCapacity = 1 << 16;
+int dustPerTick = 32;
+ParticleSystem particles;
+Shader particleVertex(GL_VERTEX_SHADER, IDR_RCDATA10);
+Shader particleFragment(GL_FRAGMENT_SHADER, IDR_RCDATA11, { IDR_RCDATA5 });
+
+// Points straight from the SoA arrays, one upload per field; drawn after the sprites, whose
+// pass uploads the column depths they are occluded by.
+ShaderProgram particleRenderProgram({
+    .Shaders = { particleVertex, particleFragment },
+    .onBuild = []()
+    {
+        particleplayerposloc = glGetUniformLocation(particleRenderProgram.SELF, "playerpos");
+        particleplayerrotloc = glGetUniformLocation(particleRenderProgram.SELF, "playerrot");
+        particleaspectratioloc = glGetUniformLocation(particleRenderProgram.SELF, "aspectratio");
+        particleresolutionloc = glGetUniformLocation(particleRenderProgram.SELF, "resolution");
+        particleframecountloc = glGetUniformLocation(particleRenderProgram.SELF, "frameCount");
+        particlecountloc = glGetUniformLocation(particleRenderProgram.SELF, "particleCount");
+
+        particles.Reserve(particleCapacity);
+        glCreateBuffers(1, &particlesloc);
+        glNamedBufferStorage(particlesloc, (GLsizeiptr)particleCapacity * 4 * sizeof(float), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, particlesloc);
+        glEnable(GL_PROGRAM_POINT_SIZE);
+    },
+    .onInvoke = []()
+    {
+        GLsizei count = particles.Count();
+        if (count == 0) return;
+        const std::vector<float>* fields[] = { &particles.posX, &particles.posY, &particles.posZ, &particles.life };
+        for (int field = 0; field < 4; field++)
+        {
+            glNamedBufferSubData(particlesloc, (GLintptr)field * count * sizeof(float), count * sizeof(float), fields[field]->data());
+        }
+
+        glUniform2f(particleplayerposloc, (float)playerposraw[0], (float)playerposraw[1]);
+        glUniform2f(particleplayerrotloc, (float)playerrotraw[0], (float)playerrotraw[1]);
+        glUniform1f(particleaspectratioloc, aspectratio);
+        glUniform2f(particleresolutionloc, (float)framebufferSize[0], (float)framebufferSize[1]);
+        glUniform1ui(particleframecountloc, frameCount - 1);
+        glUniform1i(particlecountloc, count);
+        glDrawArrays(GL_POINTS, 0, count);
+    }
+    });
+
+/*=============================================================================+/
+								  Benchmarks
+/+=============================================================================*/
+
+// Run with: QRN.exe --bench [name] [iterations]
+// Render benchmarks time whatever driver the window ends up on, so pointing the process at
+// Mesa's opengl32.dll (llvmpipe) benchmarks the software rasterizer the same way.
+struct Benchmark
+{
+    const char* name;
+    std::function<void(Window& window, int iterations)> run;
+};
+
+std::vector<Benchmark> benchmarks =
+{
+    {"render", [](Window& window, int iterations)
+    {
+        const std::array<std::pair<const char*, RenderMode>, 3> modes =
+        {{
+            { "fragment", RenderMode::Fragment },
+            { "compute", RenderMode::Compute },
+            { "raster", RenderMode::Raster },
+        }};
+
+        GLuint query;
+        glGenQueries(1, &query);
+        for (const auto& [name, mode] : modes)
+        {
+            renderMode = mode;
+            double gpuTotal = 0.0;
+            double wallTotal = 0.0;
+            for (int i = -10; i < iterations; i++) // <-- negative iterations are warm up
+            {
+                // sweep one full turn so every mode renders the same set of views
+                double halfAngle = std::numbers::pi * (double)i / (double)iterations;
+                playerrotraw = { std::cos(halfAngle), std::sin(halfAngle) };
+
+                auto start = std::chrono::steady_clock::now();
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                window.info.onRender();
+                glEndQuery(GL_TIME_ELAPSED);
+                glFinish();
+                auto end = std::chrono::steady_clock::now();
+
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                if (i < 0) continue;
+                gpuTotal += (double)elapsed * 1e-6;
+                wallTotal += std::chrono::duration<double, std::milli>(end - start).count();
+            }
+
+            double rays = (double)framebufferSize[0] * (double)framebufferSize[1] * (double)iterations;
+            std::cout << "render/" << name << "  " << framebufferSize[0] << "x" << framebufferSize[1]
+                << "  gpu " << gpuTotal / iterations << " ms"
+                << "  wall " << wallTotal / iterations << " ms"
+                << "  " << rays / (wallTotal * 1e3) << " Mrays/s" << std::endl;
+        }
+        glDeleteQueries(1, &query);
+        renderMode = RenderMode::Fragment;
+    }},
+    {"steps", [](Window& window, int iterations)
+    {
+        // DDA iterations per ray over one full turn, to compare maps and acceleration structures
+        // and the two ray marching paths
+        stepHeatmap = true;
+        stepStatsInterval = INFINITY;
+        for (auto [name, mode] : { std::pair{ "steps/fragment", RenderMode::Fragment }, std::pair{ "steps/compute", RenderMode::Compute } })
+        {
+            renderMode = mode;
+            stepStatsPending = false;
+            stepStatsTotals = {};
+            for (int i = -10; i <= iterations; i++)
+            {
+                double halfAngle = std::numbers::pi * (double)i / (double)iterations;
+                playerrotraw = { std::cos(halfAngle), std::sin(halfAngle) };
+                if (i == 0) stepStatsTotals = {}; // <-- the read at i == 0 is the last warm up frame
+                window.info.onRender();
+                glFinish();
+            }
+            stepStatsTotals.Print(name);
+        }
+        renderMode = RenderMode::Fragment;
+        stepHeatmap = false;
+        stepStatsPending = false;
+        stepStatsInterval = 1.0;
+    }},
+    {"mesher", [](Window& window, int iterations)
+    {
+        size_t quads = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) quads = MeshWalls(occupancy).size();
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "mesher  " << quads << " quads"
+            << "  " << std::chrono::duration<double, std::milli>(end - start).count() / iterations << " ms/map"
+            << std::endl;
+    }},
+    {"lightmap", [](Window& window, int iterations)
+    {
+        // everything at once, then the same bake spread over frames at the in game budget
+        lightmapBaker.Reset(occupancy, PlaceLights(occupancy));
+        lightmapBaker.Bake(INFINITY, lightmapBaked);
+        std::cout << "lightmap/full  " << lightmapBaker.lights.size() << " lights  "
+            << lightmapBaker.chunksBaked << " chunks  " << lightmapBaker.bakeMs << " ms  "
+            << lightmapBaker.bakeMs / lightmapBaker.chunksBaked << " ms/chunk" << std::endl;
+
+        lightmapBaker.Reset(occupancy, PlaceLights(occupancy));
+        int frames = 0;
+        double worstFrame = 0.0;
+        while (!lightmapBaker.Done())
+        {
+            double before = lightmapBaker.bakeMs;
+            lightmapBaker.Bake(lightmapBudgetMs, lightmapBaked);
+            worstFrame = (std::max)(worstFrame, lightmapBaker.bakeMs - before);
+            frames++;
+        }
+        std::cout << "lightmap/budgeted  " << lightmapBudgetMs << " ms budget  " << frames << " frames  "
+            << "worst frame " << worstFrame << " ms" << std::endl;
+    }},
+    {"distancefield", [](Window& window, int iterations)
+    {
+        DistanceField field;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) field.Generate(occupancy);
+        auto middle = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            int x = (int)(ChaoticHash((uint32_t)i) % (uint32_t)MapSize);
+            int y = (int)(ChaoticHash((uint32_t)i + 0x9E3779B9u) % (uint32_t)MapSize);
+            field.Update(occupancy, x, y, x + 1, y + 1);
+        }
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "distancefield/full  " << std::chrono::duration<double, std::milli>(middle - start).count() / iterations << " ms" << std::endl;
+        std::cout << "distancefield/tile  " << std::chrono::duration<double, std::milli>(end - middle).count() / iterations << " ms" << std::endl;
+    }},
+    {"lights", [](Window& window, int iterations)
+    {
+        for (int count : { 128, 512, MaxDynamicLights })
+        {
+            std::vector<DynamicLight> lights = SpawnDynamicLights(occupancy, count, 0x5EEDu);
+            LightClusterGrid grid;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+            {
+                AnimateLights(lights, i / fps);
+                BinLights(lights, grid);
+            }
+            auto end = std::chrono::steady_clock::now();
+            std::cout << "lights/cull  " << lights.size() << " lights  " << grid.indices.size() << " cluster entries  "
+                << std::chrono::duration<double, std::milli>(end - start).count() / iterations << " ms/frame" << std::endl;
+        }
+    }},
+    {"shadows", [](Window& window, int iterations)
+    {
+        // fragment path with and without shadow rays on the dynamic lights, same views
+        renderMode = RenderMode::Fragment;
+        GLuint query;
+        glGenQueries(1, &query);
+        for (bool shadows : { false, true })
+        {
+            dynamicLightShadows = shadows;
+            double gpuTotal = 0.0;
+            for (int i = -10; i < iterations; i++)
+            {
+                double halfAngle = std::numbers::pi * (double)i / (double)iterations;
+                playerrotraw = { std::cos(halfAngle), std::sin(halfAngle) };
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                window.info.onRender();
+                glEndQuery(GL_TIME_ELAPSED);
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                if (i >= 0) gpuTotal += (double)elapsed * 1e-6;
+            }
+            std::cout << "shadows/" << (shadows ? "on " : "off") << "  gpu " << gpuTotal / iterations << " ms" << std::endl;
+        }
+        glDeleteQueries(1, &query);
+        dynamicLightShadows = true;
+    }},
+    {"paths", [](Window& window, int iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        JumpTable table;
+        table.Generate(occupancy);
+        auto generated = std::chrono::steady_clock::now();
+
+        // flip a tile and flip it back, so the map is the same afterwards
+        OccupancyBits bits = occupancy;
+        for (int i = 0; i < iterations; i++)
+        {
+            int x = (int)(ChaoticHash((uint32_t)i) % (uint32_t)MapSize);
+            int y = (int)(ChaoticHash((uint32_t)i + 0x9E3779B9u) % (uint32_t)MapSize);
+            for (int pass = 0; pass < 2; pass++)
+            {
+                bits[y * OccupancyRowWords + (x >> 5)] ^= 1u << (x & 31);
+                table.Update(bits, x, y, x + 1, y + 1);
+            }
+        }
+        auto updated = std::chrono::steady_clock::now();
+        std::cout << "paths/generate  " << std::chrono::duration<double, std::milli>(generated - start).count() << " ms" << std::endl;
+        std::cout << "paths/update  " << std::chrono::duration<double, std::milli>(updated - generated).count() / (2 * iterations) << " ms/tile" << std::endl;
+
+        // NPC sized queries: random open start, goal up to 64 tiles away
+        std::vector<PathQuery> queries;
+        for (uint32_t i = 0; queries.size() < 4096; i++)
+        {
+            uint32_t h = ChaoticHash(i * 4u + 0x9A7Bu);
+            int sx = (int)(h % (uint32_t)MapSize);
+            int sy = (int)(ChaoticHash(h) % (uint32_t)MapSize);
+            int gx = sx + (int)(ChaoticHash(h + 1u) % 129u) - 64;
+            int gy = sy + (int)(ChaoticHash(h + 2u) % 129u) - 64;
+            if (IsOccupied(occupancy, sx, sy) || IsOccupied(occupancy, gx, gy)) continue;
+            queries.push_back({ sx, sy, gx, gy });
+        }
+        std::vector<PathResult> results;
+        FindPaths(table, occupancy, queries, results, pathScratch); // <-- warm the pool
+        auto batchStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) FindPaths(table, occupancy, queries, results, pathScratch);
+        auto batchEnd = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(batchEnd - batchStart).count() / iterations;
+        long long expanded = 0;
+        int found = 0;
+        for (const PathResult& result : results) { expanded += result.expanded; found += result.found; }
+        std::cout << "paths/batch  " << queries.size() << " queries  " << ms << " ms  "
+            << queries.size() * 1000.0 / ms << " queries/s  " << found << " found  "
+            << (double)expanded / queries.size() << " expanded/query" << std::endl;
+    }},
+    {"flowfield", [](Window& window, int iterations)
+    {
+        // goal starts at the first open tile near the middle and wanders like a player would
+        int goalX = MapSize / 2, goalY = MapSize / 2;
+        while (IsOccupied(occupancy, goalX, goalY)) goalX++;
+
+        FlowFieldCache cache;
+        cache.Reset(occupancy);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < (std::min)(iterations, 20); i++)
+        {
+            FlowField field;
+            cache.Generate(field, goalX, goalY);
+        }
+        auto generated = std::chrono::steady_clock::now();
+        double generateMs = std::chrono::duration<double, std::milli>(generated - start).count() / (std::min)(iterations, 20);
+
+        cache.Toward(goalX, goalY);
+        double retargetMs = 0.0;
+        for (int i = 0; i < iterations; i++)
+        {
+            for (int turn = 0; turn < PathDirections; turn++)
+            {
+                int k = (int)((ChaoticHash((uint32_t)i) + turn) % PathDirections);
+                if (!(cache.moves[(size_t)goalY * MapSize + goalX] & (1u << k))) continue;
+                goalX += PathStep[k][0];
+                goalY += PathStep[k][1];
+                break;
+            }
+            auto before = std::chrono::steady_clock::now();
+            cache.Toward(goalX, goalY);
+            retargetMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before).count();
+        }
+        std::cout << "flowfield/generate  " << generateMs << " ms" << std::endl;
+        std::cout << "flowfield/move  " << retargetMs / iterations << " ms  " << cache.retargeted << " retargeted  "
+            << cache.hits << " cached  " << cache.generated << " generated" << std::endl;
+
+        EntitySystem entities;
+        SpawnRandomEntities(entities, occupancy, 100000, 0xF10Fu);
+        const FlowField& field = cache.Toward(goalX, goalY);
+        auto steerStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) SteerEntities(entities, field, 3.0f, 4.0f, 1.0f / 60.0f);
+        auto steerEnd = std::chrono::steady_clock::now();
+        std::cout << "flowfield/steer  " << entities.Count() << " entities  "
+            << std::chrono::duration<double, std::milli>(steerEnd - steerStart).count() / iterations << " ms" << std::endl;
+    }},
+    {"sight", [](Window& window, int iterations)
+    {
+        // random segments up to maxLength long, on the generated map and two noise maps
+        struct SightMap { const char* name; OccupancyBits bits; };
+        std::vector<SightMap> maps = { { "generated", occupancy }, { "sparse", NoiseMap(0.05f, 1) }, { "dense", NoiseMap(0.2f, 2) } };
+        for (const SightMap& map : maps)
+        {
+            DistanceField field;
+            field.Generate(map.bits);
+            for (float maxLength : { 8.0f, 64.0f, 512.0f })
+            {
+                SightBatch batch;
+                for (uint32_t i = 0; batch.Count() < 65536; i++)
+                {
+                    float x = UintToUnit(ChaoticHash(i * 4u)) * MapSize;
+                    float y = UintToUnit(ChaoticHash(i * 4u + 1u)) * MapSize;
+                    float angle = UintToUnit(ChaoticHash(i * 4u + 2u)) * 2.0f * std::numbers::pi_v<float>;
+                    float length = UintToUnit(ChaoticHash(i * 4u + 3u)) * maxLength;
+                    float tx = x + std::cos(angle) * length;
+                    float ty = y + std::sin(angle) * length;
+                    if (tx < 0.0f || ty < 0.0f || tx >= MapSize || ty >= MapSize) continue;
+                    batch.Add(x, y, tx, ty);
+                }
+                double total = 0.0;
+                for (int i = 0; i < iterations; i++)
+                {
+                    CheckSight(map.bits, field, batch);
+                    total += batch.lastMs;
+                }
+                int visible = 0, mismatched = 0;
+                for (int i = 0; i < batch.Count(); i++)
+                {
+                    visible += batch.Visible(i);
+                    mismatched += batch.Visible(i) != SegmentClear(map.bits, batch.ax[i], batch.ay[i], batch.bx[i], batch.by[i]);
+                }
+                std::cout << "sight/" << map.name << "  up to " << maxLength << " tiles  "
+                    << batch.Count() * 1000.0 * iterations / total / 1e6 << " M queries/s  "
+                    << visible * 100.0 / batch.Count() << "% visible  " << mismatched << " differ from SegmentClear" << std::endl;
+            }
+        }
+    }},
+    {"fixedrays", [](Window& window, int iterations)
+    {
+        // CastRay against CastRayFixed on the same rays, scalar, one thread
+        struct RayMap { const char* name; OccupancyBits bits; };
+        std::vector<RayMap> maps = { { "generated", occupancy }, { "sparse", NoiseMap(0.02f, 3) }, { "dense", NoiseMap(0.2f, 4) } };
+        constexpr int rays = 1 << 16;
+        std::vector<float> ox(rays), oy(rays), dx(rays), dy(rays), floatHits(rays), fixedHits(rays);
+        for (const RayMap& map : maps)
+        {
+            for (int i = 0; i < rays; i++)
+            {
+                uint32_t h = ChaoticHash((uint32_t)i * 3u + 0xF1Du);
+                ox[i] = UintToUnit(h) * MapSize;
+                oy[i] = UintToUnit(ChaoticHash(h)) * MapSize;
+                float angle = UintToUnit(ChaoticHash(h + 1u)) * 2.0f * std::numbers::pi_v<float>;
+                dx[i] = std::cos(angle);
+                dy[i] = std::sin(angle);
+            }
+            auto time = [&](auto&& cast, std::vector<float>& hits)
+            {
+                auto start = std::chrono::steady_clock::now();
+                for (int k = 0; k < iterations; k++)
+                {
+                    for (int i = 0; i < rays; i++) hits[i] = cast(map.bits, ox[i], oy[i], dx[i], dy[i], 1000.0f);
+                }
+                return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ((double)rays * iterations);
+            };
+            double floatNs = time([](auto&&... a) { return CastRay(a...); }, floatHits);
+            double fixedNs = time([](auto&&... a) { return CastRayFixed(a...); }, fixedHits);
+            int differ = 0;
+            for (int i = 0; i < rays; i++) differ += std::abs(floatHits[i] - fixedHits[i]) > 1e-3f;
+            std::cout << "fixedrays/" << map.name << "  float " << floatNs << " ns/ray  fixed " << fixedNs << " ns/ray  "
+                << differ << " of " << rays << " hits differ by more than 0.001" << std::endl;
+        }
+
+        // the same switch the F key flips, through a real CPU renderer
+        WorldBatch worlds;
+        for (int m = 0; m < 4; m++) worlds.AddMap(0.05f + 0.05f * m, 0xF1Eu + (uint32_t)m);
+        for (int w = 0; w < 1024; w++) worlds.AddWorld(w % 4, 0, 0xF1Fu + (uint32_t)w * 7919u);
+        ObservationBatch views;
+        for (CpuRayMode mode : { CpuRayMode::Float, CpuRayMode::Fixed })
+        {
+            cpuRayMode = mode;
+            double ms = 0.0;
+            for (int i = 0; i < iterations; i++)
+            {
+                RenderWorldObservations(worlds, views);
+                ms += views.lastMs;
+            }
+            std::cout << "fixedrays/observations  " << (mode == CpuRayMode::Fixed ? "fixed" : "float") << "  "
+                << ms / iterations << " ms/batch of " << views.views << " views" << std::endl;
+        }
+        cpuRayMode = CpuRayMode::Float;
+    }},
+    {"sprites", [](Window& window, int iterations)
+    {
+        // CPU prepare and GPU draw over one full turn, sprite counts from a crowd up to the cap
+        GLuint query;
+        glGenQueries(1, &query);
+        std::vector<Sprite> saved = sprites;
+        for (int count : { 1024, 8192, MaxSprites })
+        {
+            sprites = SpawnSprites(occupancy, count, 0x5B17Eu);
+            double columnsMs = 0.0, cullMs = 0.0, sortMs = 0.0, gpuMs = 0.0;
+            long long drawn = 0;
+            for (int i = 0; i < iterations; i++)
+            {
+                double halfAngle = std::numbers::pi * (double)i / (double)iterations;
+                playerrotraw = { std::cos(halfAngle), std::sin(halfAngle) };
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                spriteRenderProgram();
+                glEndQuery(GL_TIME_ELAPSED);
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                gpuMs += (double)elapsed * 1e-6;
+                columnsMs += spriteRenderer.columnsMs;
+                cullMs += spriteRenderer.cullMs;
+                sortMs += spriteRenderer.sortMs;
+                drawn += spriteRenderer.Count();
+            }
+            std::cout << "sprites  " << sprites.size() << " sprites  " << (double)drawn / iterations << " drawn  "
+                << "columns " << columnsMs / iterations << " ms  cull " << cullMs / iterations << " ms  "
+                << "sort " << sortMs / iterations << " ms  gpu " << gpuMs / iterations << " ms" << std::endl;
+        }
+        sprites = saved;
+        glDeleteQueries(1, &query);
+    }},
+    {"particles", [](Window& window, int iterations)
+    {
+        // a million long lived sparks from bursts all over the map, per kernel
+        unsigned cores = (unsigned)Jobs().Workers();
+        ParticleSystem system;
+        system.Reserve(1 << 20);
+        for (uint32_t i = 0; system.Count() < 1000000; i++)
+        {
+            uint32_t h = ChaoticHash(i + 0x5A7Cu);
+            float x = UintToUnit(h) * MapSize;
+            float y = UintToUnit(ChaoticHash(h)) * MapSize;
+            if (IsOccupied(occupancy, (int)x, (int)y)) continue;
+            EmitBurst(system, x, y, 2.0f, (std::min)(256, 1000000 - system.Count()), 6.0f, 1e9f, h);
+        }
+        Isa active = ActiveIsa();
+        for (int tier = (int)active; tier >= 0; tier--)
+        {
+            ForceIsa((Isa)tier);
+            if (tier != (int)active && ParticleSystem::StepKernel().Bound() != (Isa)tier) continue; // <-- same kernel as a tier above
+            double ms = 0.0;
+            for (int i = 0; i < iterations; i++)
+            {
+                system.Step(1.0f / 60.0f, occupancy);
+                ms += system.stepMs;
+            }
+            double perSecond = system.Count() * 1000.0 * iterations / ms;
+            std::cout << "particles/" << IsaName(ParticleSystem::StepKernel().Bound()) << "  " << system.Count() << " particles  "
+                << ms / iterations << " ms/tick  " << perSecond / 1e6 << " M/s  "
+                << perSecond / cores / 1e6 << " M/s/core (" << cores << " cores)  "
+                << system.wallBounces << " wall bounces" << std::endl;
+        }
+        ForceIsa(active);
+
+        // short lives refilled every tick, so compaction has work to do
+        system.Clear();
+        double stepMs = 0.0, compactMs = 0.0;
+        long long died = 0;
+        for (int i = 0; i < iterations; i++)
+        {
+            for (uint32_t k = 0; system.Count() < 1000000; k++)
+            {
+                uint32_t h = ChaoticHash((uint32_t)i * 7919u + k);
+                float x = UintToUnit(h) * MapSize;
+                float y = UintToUnit(ChaoticHash(h)) * MapSize;
+                if (IsOccupied(occupancy, (int)x, (int)y)) continue;
+                EmitBurst(system, x, y, 2.0f, (std::min)(256, 1000000 - system.Count()), 6.0f, 1.0f, h);
+            }
+            system.Step(1.0f / 60.0f, occupancy);
+            stepMs += system.stepMs;
+            compactMs += system.compactMs;
+            died += system.died;
+        }
+        std::cout << "particles/churn  " << (double)died / iterations << " died/tick  step " << stepMs / iterations
+            << " ms  compact " << compactMs / iterations << " ms" << std::endl;
+    }},
+    {"isa", [](Window& window, int iterations)
+    {
+        // every dispatched kernel at every tier this CPU runs that has its own version
+        Isa active = ActiveIsa();
+        std::cout << "isa  supported " << IsaName(SupportedIsa()) << "  active " << IsaName(active) << std::endl;
+        auto timeTiers = [&](const char* name, Isa (*bound)(), const char* unit, double work, auto&& run)
+        {
+            for (int tier = (int)active; tier >= 0; tier--)
+            {
+                ForceIsa((Isa)tier);
+                if (bound() != (Isa)tier) continue;
+                run(); // <-- warm up
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; i++) run();
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+                std::cout << "isa/" << name << "/" << IsaName((Isa)tier) << "  " << ms << " ms  " << work / ms / 1e3 << " " << unit << std::endl;
+            }
+            ForceIsa(active);
+        };
+
+        std::vector<uint32_t> seeds(1 << 20), hashes(1 << 20);
+        for (size_t i = 0; i < seeds.size(); i++) seeds[i] = (uint32_t)i;
+        timeTiers("hash", [] { return hashBatchKernel.Bound(); }, "M hashes/s", (double)seeds.size(),
+            [&] { HashBatch(seeds.data(), hashes.data(), (int)seeds.size()); });
+
+        SightBatch batch;
+        for (uint32_t i = 0; batch.Count() < 65536; i++)
+        {
+            float x = UintToUnit(ChaoticHash(i * 4u)) * MapSize;
+            float y = UintToUnit(ChaoticHash(i * 4u + 1u)) * MapSize;
+            float tx = x + (UintToUnit(ChaoticHash(i * 4u + 2u)) - 0.5f) * 128.0f;
+            float ty = y + (UintToUnit(ChaoticHash(i * 4u + 3u)) - 0.5f) * 128.0f;
+            if (tx < 0.0f || ty < 0.0f || tx >= MapSize || ty >= MapSize) continue;
+            batch.Add(x, y, tx, ty);
+        }
+        timeTiers("sight", [] { return sightRangeKernel.Bound(); }, "M queries/s", (double)batch.Count(),
+            [&] { CheckSight(occupancy, distanceField, batch); });
+
+        EntitySystem entities;
+        SpawnRandomEntities(entities, occupancy, 50000, 0x15Au);
+        timeTiers("entities", [] { return EntitySystem::MoveKernel().Bound(); }, "M entity ticks/s", (double)entities.Count(),
+            [&] { entities.Step(1.0f / 60.0f, distanceField, occupancy); });
+
+        ParticleSystem system;
+        system.Reserve(1 << 20);
+        EmitBurst(system, 256.5f, 256.5f, 2.0f, 1 << 20, 6.0f, 1e9f, 0x15Au);
+        timeTiers("particles", [] { return ParticleSystem::StepKernel().Bound(); }, "M particle ticks/s", (double)system.Count(),
+            [&] { system.Step(1.0f / 60.0f, occupancy); });
+    }},
+    {"jobs", [](Window& window, int iterations)
+    {
+        // the same CPU frame work at 1, 2, 4, ... workers up to the hardware: distance field,
+        // mesher, entity tick, particle tick, sprite columns
+        int hardware = (int)(std::max)(1u, std::thread::hardware_concurrency());
+        EntitySystem entities;
+        SpawnRandomEntities(entities, occupancy, 50000, 0x10B5u);
+        ParticleSystem system;
+        system.Reserve(1 << 18);
+        EmitBurst(system, 256.5f, 256.5f, 2.0f, 1 << 18, 6.0f, 1e9f, 0x10B5u);
+        SpriteRenderer renderer;
+        SpriteCamera camera = MakeSpriteCamera((float)playerposraw[0], (float)playerposraw[1], 1.0f, 0.0f, 16.0f / 9.0f, 4096);
+        DistanceField field;
+
+        double baseline = 0.0;
+        for (int workers = 1; ; workers = (std::min)(workers * 2, hardware))
+        {
+            Jobs().Start(workers);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++)
+            {
+                field.Generate(occupancy);
+                MeshWalls(occupancy);
+                entities.Step(1.0f / 60.0f, distanceField, occupancy);
+                system.Step(1.0f / 60.0f, occupancy);
+                renderer.ColumnDepths(occupancy, camera);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+            JobStats stats = Jobs().Stats();
+            if (workers == 1) baseline = ms;
+            std::cout << "jobs  " << workers << " workers  " << ms << " ms/frame  speedup " << baseline / ms
+                << "  utilization " << stats.Utilization() * 100.0 << "%  " << stats.Jobs() / iterations << " jobs/frame  "
+                << stats.Steals() / iterations << " steals/frame" << std::endl;
+            for (size_t w = 0; w < stats.workers.size(); w++)
+            {
+                const WorkerStats& worker = stats.workers[w];
+                std::cout << "jobs    worker " << w << "  " << worker.utilization * 100.0 << "% busy  "
+                    << worker.jobs << " jobs  " << worker.steals << " steals  " << worker.failedSteals << " failed steals" << std::endl;
+            }
+            if (workers == hardware) break;
+        }
+    }},
+    {"entities", [](Window& window, int iterations)
+    {
+        // one fixed 60 Hz tick per iteration, crowd size from a few thousand up to the 100k target
+        for (int count : { 10000, 50000, 100000 })
+        {
+            EntitySystem entities;
+            SpawnRandomEntities(entities, occupancy, count, 0xA6E47u);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) entities.Step(1.0f / 60.0f, distanceField, occupancy);
+            auto end = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+            std::cout << "entities/step  " << entities.Count() << " entities  " << ms << " ms/tick  "
+                << 1000.0 / ms << " ticks/s  " << entities.wallContacts << " wall  "
+                << entities.entityContacts << " pair contacts" << std::endl;
+        }
+    }},
+    {"net", [](Window& window, int iterations)
+    {
+        // server and clients in this process over loopback UDP, clients driven like random
+        // agents, as fast as the server ticks; rates are per simulated 60 Hz second
+        constexpr float dt = 1.0f / 60.0f;
+        WorldMap world;
+        world.bits = occupancy;
+        world.field.Generate(world.bits);
+        for (int players : { 8, 32, 128, 512 })
+        {
+            ReplicationServer server(world);
+            NetAddress address = server.Address();
+            std::vector<std::unique_ptr<ReplicationClient>> clients;
+            std::vector<float> angles(players, 0.0f);
+            for (int i = 0; i < players; i++) clients.push_back(std::make_unique<ReplicationClient>(address));
+
+            double ms = 0.0;
+            for (int tick = 0; tick < iterations; tick++)
+            {
+                for (int i = 0; i < players; i++)
+                {
+                    clients[i]->Receive();
+                    uint32_t h = ChaoticHash((uint32_t)i * 0x9E3779B9u + (uint32_t)(tick * dt * 2.0f));
+                    angles[i] += (UintToUnit(ChaoticHash(h + 1u)) * 2.0f - 1.0f) * 3.0f * dt;
+                    clients[i]->SendInput(UintToUnit(h) * 2.0f - 0.5f, UintToUnit(ChaoticHash(h)) * 2.0f - 1.0f,
+                        std::cos(0.5f * angles[i]), std::sin(0.5f * angles[i]));
+                }
+                server.Tick(dt);
+                ms += server.lastTickMs;
+            }
+
+            // every client should hold exactly what the server sent for its newest tick
+            uint64_t down = 0, up = 0, rejected = 0;
+            int mismatched = 0;
+            for (auto& client : clients)
+            {
+                client->Receive();
+                const std::vector<NetPlayerState>* sent = server.Snapshot(client->tick);
+                mismatched += !sent || *sent != client->players;
+                down += client->stats.bytesReceived;
+                up += client->stats.bytesSent;
+                rejected += client->stats.rejected;
+            }
+            double seconds = iterations * dt;
+            int raw = NetSnapshotHeaderBytes + players * (2 * NetPositionBits + NetAngleBits) / 8;
+            std::cout << "net  " << players << " players  " << ms / iterations << " ms/server tick  "
+                << down / (players * seconds) << " B/client/s down (" << raw / dt << " uncompressed)  "
+                << up / (players * seconds) << " B/client/s up  " << server.stats.deltaSnapshots << " delta  "
+                << server.stats.fullSnapshots << " full snapshots  " << rejected << " rejected  "
+                << mismatched << " clients out of sync" << std::endl;
+        }
+    }},
+    {"observations", [](Window& window, int iterations)
+    {
+        // one agent view per world, 4096 worlds on 16 maps, moving a tick between batches
+        WorldBatch worlds;
+        for (int m = 0; m < 16; m++) worlds.AddMap(0.05f + 0.01f * m, 0x0B5u + (uint32_t)m);
+        for (int w = 0; w < 4096; w++) worlds.AddWorld(w % 16, 0, 0x5EEu + (uint32_t)w * 7919u);
+        for (std::array<int, 2> size : { std::array<int, 2>{ 64, 48 }, std::array<int, 2>{ 128, 96 } })
+        {
+            ObservationBatch views;
+            views.width = size[0];
+            views.height = size[1];
+            double ms = 0.0;
+            for (int i = 0; i < iterations; i++)
+            {
+                DriveRandomAgents(worlds, 1.0f / 60.0f);
+                worlds.Step(1.0f / 60.0f);
+                RenderWorldObservations(worlds, views);
+                ms += views.lastMs;
+            }
+            std::cout << "observations  " << views.width << "x" << views.height << "  " << views.views << " views  "
+                << ms / iterations << " ms/batch  " << views.views * iterations * 1000.0 / ms / 1e6 << " M views/s  "
+                << views.pixels.size() / (1024.0 * 1024.0) << " MB buffer  steps/column mean " << views.MeanSteps()
+                << "  p99 " << views.StepPercentile(0.99) << "  max " << views.stepMax << std::endl;
+        }
+    }},
+    {"snapshots", [](Window& window, int iterations)
+    {
+        // a rollback ring: every tick edits some tiles, steps 10k entities and snapshots into
+        // the oldest of 60 slots; every 10th tick rolls back 30 ticks and checks the map
+        // against a hash taken when that snapshot was captured
+        auto map = std::make_unique<TileMap>(mapdata);
+        auto hashMap = [&] { return std::hash<std::string_view>()(std::string_view((const char*)map->data(), sizeof(TileMap))); };
+        auto check = std::make_unique<TileMap>();
+        CowRegion pages(map->data(), sizeof(TileMap));
+        EntitySystem entities;
+        SpawnRandomEntities(entities, occupancy, 10000, 0x5AFEu);
+        std::array<double, 2> position = playerposraw, rotor = playerrotraw;
+        for (int edits : { 0, 16, 256 })
+        {
+            std::vector<std::unique_ptr<WorldSnapshot>> ring;
+            std::vector<size_t> hashes(60);
+            for (int i = 0; i < 60; i++) ring.push_back(std::make_unique<WorldSnapshot>());
+            double captureMs = 0.0, restoreMs = 0.0, copyMs = 0.0;
+            uint64_t captured = 0, restored = 0;
+            int rollbacks = 0, wrong = 0;
+            for (int tick = 0; tick < iterations; tick++)
+            {
+                for (int e = 0; e < edits; e++)
+                {
+                    uint32_t h = ChaoticHash((uint32_t)(tick * edits + e));
+                    int x = 1 + (int)(h % (MapSize - 2)), y = 1 + (int)((h >> 16) % (MapSize - 2));
+                    (*map)[y * MapSize + x] = (*map)[y * MapSize + x] > 0.5f ? 0.0f : 1.0f;
+                    TouchTiles(pages, x, y, x + 1, y + 1);
+                }
+                entities.Step(1.0f / 60.0f, distanceField, occupancy);
+
+                auto start = std::chrono::steady_clock::now();
+                ring[tick % 60]->Capture(pages, position, rotor, &entities);
+                auto end = std::chrono::steady_clock::now();
+                captureMs += std::chrono::duration<double, std::milli>(end - start).count();
+                captured += pages.capturedPages;
+                hashes[tick % 60] = hashMap();
+
+                // what a snapshot costs without copy on write
+                start = std::chrono::steady_clock::now();
+                *check = *map;
+                copyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                if (tick % 10 == 9 && tick >= 60)
+                {
+                    int back = (tick - 30) % 60;
+                    start = std::chrono::steady_clock::now();
+                    restored += ring[back]->Restore(pages, position, rotor, &entities);
+                    restoreMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    rollbacks++;
+                    wrong += hashMap() != hashes[back];
+                }
+            }
+            std::cout << "snapshots  " << edits << " edits/tick  capture " << captureMs * 1000.0 / iterations << " us ("
+                << (double)captured / iterations << " pages)  rollback " << (rollbacks ? restoreMs * 1000.0 / rollbacks : 0.0) << " us ("
+                << (rollbacks ? (double)restored / rollbacks : 0.0) << " pages)  full map copy " << copyMs * 1000.0 / iterations << " us  "
+                << pages.PoolPages() << " pooled pages  " << wrong << " bad rollbacks" << std::endl;
+        }
+    }},
+    {"edits", [](Window& window, int iterations)
+    {
+        // random interior tiles toggled every frame, then everything derived brought up to
+        // date; the whole map marked dirty is the cost without regional updates
+        auto original = std::make_unique<TileMap>(mapdata);
+        auto timeApply = [&]
+        {
+            auto start = std::chrono::steady_clock::now();
+            ApplyMapEdits();
+            glFinish();
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        for (int edits : { 1, 8, 64 })
+        {
+            double ms = 0.0;
+            int rects = 0;
+            size_t chunks = 0;
+            for (int i = 0; i < iterations; i++)
+            {
+                for (int e = 0; e < edits; e++)
+                {
+                    uint32_t h = ChaoticHash((uint32_t)(i * edits + e) ^ 0xED17u);
+                    int x = 1 + (int)(h % (MapSize - 2)), y = 1 + (int)((h >> 16) % (MapSize - 2));
+                    SetTile(x, y, !IsWallValue(mapdata[(size_t)y * MapSize + x]));
+                }
+                lightmapBaker.pending.clear(); // <-- queued chunks only counted, baking is budgeted per frame
+                ms += timeApply();
+                rects += mapEdits.coalesced;
+                chunks += lightmapBaker.pending.size();
+            }
+            std::cout << "edits  " << edits << " tiles/frame  " << ms / iterations << " ms/frame  "
+                << (double)rects / iterations << " rects after coalescing  " << (double)chunks / iterations << " lightmap chunks queued" << std::endl;
+        }
+
+        mapdata = *original;
+        mapPages.TouchAll();
+        mapEdits.Touch(0, 0, MapSize, MapSize);
+        double fullMs = timeApply();
+        std::cout << "edits  whole map  " << fullMs << " ms" << std::endl;
+        BakeLightmap(INFINITY);
+    }},
+    {"mapstore", [](Window& window, int iterations)
+    {
+        // reader threads doing collision, column rays (as the CPU renderers cast them) and line
+        // of sight against pinned versions
+        // while one writer publishes a version a millisecond; each publish toggles two
+        // sentinel tiles together with 16 random ones, so a reader seeing them differ within
+        // one pin saw a torn map. Run again with a reader holding its pin for 100 ms at a time.
+        constexpr int sx0 = 1, sy0 = 1, sx1 = MapSize - 2, sy1 = MapSize - 2;
+        int readerCount = (std::max)(2, (std::min)((int)std::thread::hardware_concurrency() - 2, 7));
+        for (bool longReader : { false, true })
+        {
+            MapStore store;
+            OccupancyBits start = occupancy;
+            start[sy0 * OccupancyRowWords + (sx0 >> 5)] &= ~(1u << (sx0 & 31));
+            start[sy1 * OccupancyRowWords + (sx1 >> 5)] &= ~(1u << (sx1 & 31));
+            store.Reset(start);
+
+            std::atomic<bool> stop{ false };
+            std::atomic<uint64_t> reads{ 0 }, torn{ 0 };
+            std::atomic<int> longestPinned{ 0 };
+            std::vector<std::thread> readers;
+            for (int r = 0; r < readerCount; r++)
+            {
+                readers.emplace_back([&, r]
+                {
+                    uint32_t seed = 0x5EEDu + (uint32_t)r * 7919u;
+                    uint64_t count = 0;
+                    float checksum = 0.0f;
+                    while (!stop.load(std::memory_order_relaxed))
+                    {
+                        MapStore::View map = store.Read();
+                        const OccupancyBits& bits = map.Bits();
+                        bool before = IsOccupied(bits, sx0, sy0);
+                        for (int i = 0; i < 64; i++)
+                        {
+                            uint32_t h = ChaoticHash(seed++);
+                            float x = 1.0f + (float)(h % ((MapSize - 2) * 16)) / 16.0f, y = 1.0f + (float)((h >> 12) % ((MapSize - 2) * 16)) / 16.0f;
+                            float angle = (float)(h >> 24) * (2.0f * std::numbers::pi_v<float> / 256.0f);
+                            if (r % 3 == 0) { ResolveCircleTiles(bits, x, y, 0.3f); checksum += x + y; }
+                            else if (r % 3 == 1) checksum += TraceRay(bits, x, y, std::cos(angle), std::sin(angle), 64.0f);
+                            else checksum += SegmentClear(bits, x, y, x + 16.0f * std::cos(angle), y + 16.0f * std::sin(angle));
+                        }
+                        if (IsOccupied(bits, sx1, sy1) != before || IsOccupied(bits, sx0, sy0) != before) torn++;
+                        count++;
+                    }
+                    reads += count * 64;
+                    if (checksum == -1.0f) std::cout << ""; // <-- keeps the work from being optimized away
+                });
+            }
+            std::thread holder;
+            if (longReader)
+            {
+                holder = std::thread([&]
+                {
+                    while (!stop.load(std::memory_order_relaxed))
+                    {
+                        MapStore::View map = store.Read();
+                        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+                        while (std::chrono::steady_clock::now() < until && !stop.load(std::memory_order_relaxed))
+                            if (IsOccupied(map.Bits(), sx0, sy0) != IsOccupied(map.Bits(), sx1, sy1)) torn++;
+                    }
+                });
+            }
+
+            int publishes = iterations * 10;
+            std::vector<double> latencies;
+            std::vector<TileChange> changes;
+            int mostRetired = 0;
+            auto begin = std::chrono::steady_clock::now();
+            for (int p = 0; p < publishes; p++)
+            {
+                while (std::chrono::steady_clock::now() < begin + std::chrono::milliseconds(p)) std::this_thread::yield();
+                bool wall = p % 2 == 0;
+                changes.assign({ { sx0, sy0, wall }, { sx1, sy1, wall } });
+                for (int e = 0; e < 16; e++)
+                {
+                    uint32_t h = ChaoticHash((uint32_t)(p * 16 + e) ^ 0xAB5u);
+                    changes.push_back({ 2 + (int)(h % (MapSize - 4)), 2 + (int)((h >> 16) % (MapSize - 4)), ((h >> 15) & 1) != 0 });
+                }
+                auto publishStart = std::chrono::steady_clock::now();
+                store.Publish(changes);
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - publishStart).count());
+                mostRetired = (std::max)(mostRetired, store.Retired());
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            stop = true;
+            for (std::thread& reader : readers) reader.join();
+            if (holder.joinable()) holder.join();
+
+            std::sort(latencies.begin(), latencies.end());
+            std::cout << "mapstore  " << readerCount << " readers" << (longReader ? " + 100 ms pin" : "") << "  "
+                << reads / seconds / 1e6 << " M queries/s  publish p50 " << latencies[latencies.size() / 2] << " us  p99 "
+                << latencies[latencies.size() * 99 / 100] << " us  max " << latencies.back() << " us  "
+                << mostRetired << " retired at most  " << store.PoolVersions() << " pooled  "
+                << store.reclaimed << " reclaimed  " << torn << " torn reads" << std::endl;
+        }
+    }},
+};
+
+/*=============================================================================+/
+								Headless Worlds
+/+=============================================================================*/
+
+// Run with: QRN.exe --worlds [count] [ticks] [--observe]
+// No window or GL: count worlds spread over 16 noise maps, 16 entities each, driven by
+// random agents at 60 Hz, with throughput and a soak check at the end. --observe also
+// renders every player's 64x48 view each tick, as agents being trained would see it.
+void RunWorlds(int count, int ticks, bool observe)
+{
+    constexpr int maps = 16;
+    constexpr float dt = 1.0f / 60.0f;
+    WorldBatch batch;
+    for (int m = 0; m < maps; m++) batch.AddMap(0.05f + 0.15f * (float)m / maps, 0x3A9u + (uint32_t)m);
+    for (int w = 0; w < count; w++) batch.AddWorld(w % maps, 16, 0xC0FFEEu + (uint32_t)w * 7919u);
+    std::cout << "worlds  " << batch.WorldCount() << " worlds on " << batch.MapCount() << " maps  "
+        << batch.EntityCount() << " entities  " << batch.MemoryBytes() / (1024.0 * 1024.0) << " MB  "
+        << Jobs().Workers() << " workers" << std::endl;
+
+    ObservationBatch views;
+    double totalMs = 0.0;
+    double reportMs = 0.0;
+    double viewMs = 0.0;
+    int reportTicks = 0;
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        DriveRandomAgents(batch, dt);
+        batch.Step(dt);
+        if (observe)
+        {
+            RenderWorldObservations(batch, views);
+            viewMs += views.lastMs;
+        }
+        totalMs += batch.lastStepMs;
+        reportMs += batch.lastStepMs;
+        if (++reportTicks == 600 || tick == ticks - 1) // <-- every ten simulated seconds
+        {
+            std::cout << "worlds  tick " << tick + 1 << "  " << reportMs / reportTicks << " ms/tick  "
+                << batch.WorldCount() * reportTicks * 1000.0 / reportMs << " world ticks/s";
+            if (observe) std::cout << "  " << viewMs / reportTicks << " ms/views  " << batch.WorldCount() * reportTicks * 1000.0 / viewMs << " views/s";
+            std::cout << std::endl;
+            reportMs = 0.0;
+            viewMs = 0.0;
+            reportTicks = 0;
+        }
+    }
+
+    uint64_t wallTicks = 0, entityTicks = 0;
+    for (int w = 0; w < batch.WorldCount(); w++)
+    {
+        wallTicks += batch.wallTicks[w];
+        entityTicks += batch.entityTicks[w];
+    }
+    int stuck = batch.PlayersInWalls();
+    std::cout << "worlds  " << (double)batch.WorldCount() * ticks * 1000.0 / totalMs << " world ticks/s overall  "
+        << wallTicks << " player wall ticks  " << entityTicks << " player entity ticks  "
+        << stuck << " players inside walls" << std::endl;
+    if (stuck) throw std::runtime_error(std::to_string(stuck) + " players ended up inside walls");
+}
+
 /*=============================================================================+/
 								  Main Function
 /+=============================================================================*/
 
-int main()
+int main(int argc, char** argv)
 {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    bool bench = !args.empty() && args[0] == "--bench";
+    auto positional = [&](size_t i) { return bench && args.size() > i && args[i].rfind("--", 0) != 0; }; // <-- options may follow
+    std::string benchFilter = positional(1) ? args[1] : "";
+    int benchIterations = positional(2) ? std::stoi(args[2]) : 200;
+    strictFrameAllocations = std::find(args.begin(), args.end(), "--strict-alloc") != args.end();
+    auto traceArg = std::find(args.begin(), args.end(), "--trace");
+    bool traceOnExit = traceArg != args.end() && traceArg + 1 != args.end();
+    if (traceOnExit) traceFile = *(traceArg + 1);
+    Profile().NameThread("main");
+    auto isaArg = std::find(args.begin(), args.end(), "--isa");
+    auto glLogArg = std::find(args.begin(), args.end(), "--gl-log");
+    if (glLogArg != args.end() && glLogArg + 1 != args.end())
+    {
+        for (uint32_t level = 0; level <= (uint32_t)LogSeverity::High; level++)
+        {
+            if (*(glLogArg + 1) == SeverityName((LogSeverity)level)) glLogSeverity = (LogSeverity)level;
+        }
+    }
+
     try
     {
+        if (isaArg != args.end() && isaArg + 1 != args.end()) ForceIsa(ParseIsa(*(isaArg + 1)));
+        if (!args.empty() && args[0] == "--worlds")
+        {
+            auto number = [&](size_t i, int fallback) { return args.size() > i && args[i].rfind("--", 0) != 0 ? std::stoi(args[i]) : fallback; };
+            RunWorlds(number(1, 1024), number(2, 3600), std::find(args.begin(), args.end(), "--observe") != args.end());
+            if (traceOnExit && !Profile().WriteChromeTrace(traceFile)) throw std::runtime_error("Could not write profile to " + traceFile);
+            return 0;
+        }
+        if (bench) std::cout << "CPU supports " << IsaName(SupportedIsa()) << ", kernels run " << IsaName(ActiveIsa()) << std::endl;
+
         Window::Info info;
 		info.title = "QRN";
         info.onUpdate = []()
@@ -465,46 +2218,73 @@ int main()
 			playerposraw[0] += movement[0] * deltaTime * movementSpeed;
 			playerposraw[1] += movement[1] * deltaTime * movementSpeed;
 
-            for (int y = playerposraw[1] - playerRadius; y < playerposraw[1] + playerRadius; y++)
+            MapStore::View map = mapStore.Read(); // <-- the published map, as a job thread would see it
             {
-                for (int x = playerposraw[0] - playerRadius; x < playerposraw[0] + playerRadius; x++)
-                {
-					float tileValue = mapdata[ y * 512 + (x)];
-					if (tileValue < 0.5f) continue; // not a wall, go next
+                PROFILE_SCOPE("collision");
+                ResolveCircle(distanceField, map.Bits(), playerposraw, playerRadius);
+            }
 
-                    std::array<double, 2> closestPoint =
-                    {
-                        std::clamp(playerposraw[0], (double)(x), (double)(x + 1)),
-                        std::clamp(playerposraw[1], (double)(y), (double)(y + 1))
-					};
-
-                    std::array<double, 2> difference =
-                    {
-                        playerposraw[0] - closestPoint[0],
-                        playerposraw[1] - closestPoint[1]
-                    };
-					double distance = Magnatude(difference);
-                    if (distance >= playerRadius) continue; // no colision
-
-					std::array<double, 2> correctionDir = NormalizeByMag(difference, playerRadius);
-					playerposraw[0] = correctionDir[0] + closestPoint[0];
-					playerposraw[1] = correctionDir[1] + closestPoint[1];
-                }
-			}
-			
+            PROFILE_SCOPE("particles");
+            EmitDust(particles, map.Bits(), (float)playerposraw[0], (float)playerposraw[1], 16.0f, dustPerTick, frameCount);
+            particles.Step((float)deltaTime, map.Bits());
         };
         info.onRender = []()
         {
+            gpuTimers.Collect();
+            ApplyMapEdits();
+            BakeLightmap(lightmapBudgetMs);
+            UpdateDynamicLights(glfwGetTime());
             glClear(GL_COLOR_BUFFER_BIT);
-            shaderProgram();
+            {
+                PROFILE_GPU_SCOPE("world pass");
+                switch (renderMode)
+                {
+                case RenderMode::Fragment: shaderProgram(); break;
+                case RenderMode::Compute: tileRenderProgram(); break;
+                case RenderMode::Raster: wallRenderProgram(); break;
+                }
+            }
+            {
+                PROFILE_GPU_SCOPE("sprite pass");
+                spriteRenderProgram();
+            }
+            {
+                PROFILE_GPU_SCOPE("particle pass");
+                particleRenderProgram();
+            }
 		};
+        if (bench)
+        {
+            // fixed size so results compare across machines
+            info.width = 1280;
+            info.height = 720;
+            info.maximize = false;
+        }
 		Window window(info); // <-- sets up OpenGL context
+        gpuTimers.Create();
+        gpuTimers.enabled = !bench; // <-- the render benchmarks wrap onRender in their own elapsed queries
 
 		mapGenProgram.Build();
+        CreateLightmap();
+        CreateDynamicLights();
 
         shaderProgram.Build();
+        tileRenderProgram.Build();
+        wallRenderProgram.Build();
+        spriteRenderProgram.Build();
+        particleRenderProgram.Build();
+
+        if (bench)
+        {
+            BakeLightmap(INFINITY); // <-- so the render benchmarks don't pay for baking
+            for (const auto& benchmark : benchmarks)
+            {
+                if (benchFilter.empty() || benchFilter == benchmark.name) benchmark.run(window, benchIterations);
+            }
+        }
+        else window();
 
-        window();
+        if (traceOnExit && !Profile().WriteChromeTrace(traceFile)) throw std::runtime_error("Could not write profile to " + traceFile);
     }
     catch (const std::runtime_error& e)
     {
@@ -0,0 +1,395 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include "Net.h"
+#include "Worlds.h"
+#include "Profile.h"
+
+/*=============================================================================+/
+								  Replication
+/+=============================================================================*/
+
+/*
+	Authoritative server and clients over loopback UDP. Clients send their input every tick
+	(move axes and view rotor, plus the newest snapshot tick they hold); the server walks
+	every player with the same rules as onUpdate (WalkPlayer) and sends each client a
+	snapshot of all players.
+	Snapshots are quantized and delta compressed:
+		- positions in 1/256 tile (17 bits covers the map), the rotor as a 16 bit angle
+		- each snapshot is coded against the newest one that client acknowledged, if the
+		  server still holds it, so a lost packet costs nothing but a larger next delta
+		- per player one bit when nothing changed, otherwise per field: unchanged, a small or
+		  medium zigzag delta, or the raw value
+	The delta body depends only on the baseline, so within a tick it is coded once per
+	distinct baseline and shared by every client on it; usually that is all of them.
+	No prediction or interpolation on the client, and players don't collide with each other,
+	as in single player.
+*/
+
+constexpr int ReplicationHistory = 32;            // <-- snapshots kept for baselines, power of two
+constexpr float NetPositionScale = 256.0f;        // <-- quantization steps per tile
+constexpr int NetPositionBits = 17;               // <-- MapSize * NetPositionScale = 2^17
+constexpr int NetAngleBits = 16;
+constexpr int NetSnapshotHeaderBytes = 13;        // <-- type, tick, baseline, players, your slot
+
+enum class NetMessage : uint8_t { Input = 1, Snapshot = 2 };
+
+struct NetPlayerState
+{
+	uint32_t x, y;
+	uint32_t angle;
+
+	bool operator==(const NetPlayerState&) const = default;
+};
+
+inline uint32_t QuantizeRotor(float rotorX, float rotorY)
+{
+	float angle = std::atan2(rotorY, rotorX) * (float)(1 << NetAngleBits) / 6.2831853f;
+	return (uint32_t)(int32_t)std::round(angle) & ((1u << NetAngleBits) - 1);
+}
+
+inline void DequantizeRotor(uint32_t angle, float& rotorX, float& rotorY)
+{
+	float radians = angle * 6.2831853f / (float)(1 << NetAngleBits);
+	rotorX = std::cos(radians);
+	rotorY = std::sin(radians);
+}
+
+inline NetPlayerState QuantizePlayer(float x, float y, float rotorX, float rotorY)
+{
+	constexpr float maxPosition = (float)((1 << NetPositionBits) - 1);
+	return {
+		(uint32_t)std::clamp(std::round(x * NetPositionScale), 0.0f, maxPosition),
+		(uint32_t)std::clamp(std::round(y * NetPositionScale), 0.0f, maxPosition),
+		QuantizeRotor(rotorX, rotorY)
+	};
+}
+
+inline void DequantizePlayer(const NetPlayerState& state, float& x, float& y, float& rotorX, float& rotorY)
+{
+	x = state.x / NetPositionScale;
+	y = state.y / NetPositionScale;
+	DequantizeRotor(state.angle, rotorX, rotorY);
+}
+
+// One field against its baseline: 0 same, 10 + 7 bit or 110 + 12 bit zigzag delta, 111 raw.
+// Angles wrap, so their delta is taken modulo the angle range.
+inline void WriteField(BitWriter& writer, uint32_t value, uint32_t base, int bits, bool wraps)
+{
+	int32_t delta = (int32_t)(value - base);
+	if (wraps) delta = (int32_t)(delta << (32 - bits)) >> (32 - bits);
+	uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+	if (zigzag == 0) writer.Write(0b0, 1);
+	else if (zigzag < (1u << 7)) { writer.Write(0b01, 2); writer.Write(zigzag, 7); }
+	else if (zigzag < (1u << 12)) { writer.Write(0b011, 3); writer.Write(zigzag, 12); }
+	else { writer.Write(0b111, 3); writer.Write(value, bits); }
+}
+
+inline uint32_t ReadField(BitReader& reader, uint32_t base, int bits)
+{
+	if (!reader.ReadBool()) return base;
+	int deltaBits = 7;
+	if (reader.ReadBool())
+	{
+		if (reader.ReadBool()) return reader.Read(bits);
+		deltaBits = 12;
+	}
+	uint32_t zigzag = reader.Read(deltaBits);
+	int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+	return (base + (uint32_t)delta) & ((1u << bits) - 1);
+}
+
+// Players that exist in the baseline are coded against it, the rest against zero.
+inline void WriteSnapshotBody(BitWriter& writer, const std::vector<NetPlayerState>& players, const std::vector<NetPlayerState>* base)
+{
+	for (size_t i = 0; i < players.size(); i++)
+	{
+		NetPlayerState from = base && i < base->size() ? (*base)[i] : NetPlayerState{};
+		bool changed = !base || i >= base->size() || !(players[i] == from);
+		writer.WriteBool(changed);
+		if (!changed) continue;
+		WriteField(writer, players[i].x, from.x, NetPositionBits, false);
+		WriteField(writer, players[i].y, from.y, NetPositionBits, false);
+		WriteField(writer, players[i].angle, from.angle, NetAngleBits, true);
+	}
+}
+
+inline bool ReadSnapshotBody(BitReader& reader, std::vector<NetPlayerState>& players, const std::vector<NetPlayerState>* base)
+{
+	for (size_t i = 0; i < players.size(); i++)
+	{
+		NetPlayerState from = base && i < base->size() ? (*base)[i] : NetPlayerState{};
+		if (!reader.ReadBool())
+		{
+			players[i] = from;
+			continue;
+		}
+		players[i].x = ReadField(reader, from.x, NetPositionBits);
+		players[i].y = ReadField(reader, from.y, NetPositionBits);
+		players[i].angle = ReadField(reader, from.angle, NetAngleBits);
+	}
+	return !reader.overrun;
+}
+
+struct ReplicationStats
+{
+	uint64_t bytesSent = 0;
+	uint64_t bytesReceived = 0;
+	uint64_t packetsSent = 0;
+	uint64_t packetsReceived = 0;
+	uint64_t fullSnapshots = 0;       // <-- sent or taken without a baseline
+	uint64_t deltaSnapshots = 0;
+	uint64_t rejected = 0;            // <-- malformed, stale or missing their baseline
+};
+
+// Snapshots by tick, ReplicationHistory deep.
+struct SnapshotHistory
+{
+	std::array<std::vector<NetPlayerState>, ReplicationHistory> players;
+	std::array<uint32_t, ReplicationHistory> ticks{};
+
+	std::vector<NetPlayerState>& Slot(uint32_t tick)
+	{
+		ticks[tick & (ReplicationHistory - 1)] = tick;
+		return players[tick & (ReplicationHistory - 1)];
+	}
+
+	const std::vector<NetPlayerState>* Find(uint32_t tick) const
+	{
+		if (tick == 0 || ticks[tick & (ReplicationHistory - 1)] != tick) return nullptr;
+		return &players[tick & (ReplicationHistory - 1)];
+	}
+};
+
+class ReplicationServer
+{
+public:
+	ReplicationStats stats;
+	uint32_t tick = 0;           // <-- last tick simulated and sent, ticks start at 1
+	double lastTickMs = 0.0;
+
+	ReplicationServer(const WorldMap& world, uint16_t port = 0) : world(world), socket(port) {}
+
+	NetAddress Address() const { return socket.Address(); }
+	int PlayerCount() const { return (int)clients.size(); }
+
+	// What the server sent for tick, while it is still held.
+	const std::vector<NetPlayerState>* Snapshot(uint32_t at) const { return history.Find(at); }
+
+	// Takes every waiting input, walks every player dt, snapshots and sends to each client.
+	void Tick(float dt)
+	{
+		PROFILE_SCOPE("server tick");
+		auto start = std::chrono::steady_clock::now();
+		ReceiveInputs();
+
+		for (Client& client : clients)
+		{
+			WalkPlayer(world, client.x, client.y, client.rotorX, client.rotorY, client.forward, client.strafe, dt);
+		}
+
+		tick++;
+		std::vector<NetPlayerState>& current = history.Slot(tick);
+		current.resize(clients.size());
+		for (size_t i = 0; i < clients.size(); i++)
+		{
+			current[i] = QuantizePlayer(clients[i].x, clients[i].y, clients[i].rotorX, clients[i].rotorY);
+		}
+		SendSnapshots(current);
+		lastTickMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+private:
+	struct Client
+	{
+		NetAddress address;
+		uint32_t sequence = 0;       // <-- newest input taken
+		uint32_t acknowledged = 0;   // <-- newest snapshot it holds
+		float x = 0.0f, y = 0.0f;
+		float rotorX = 1.0f, rotorY = 0.0f;
+		float forward = 0.0f, strafe = 0.0f;
+	};
+
+	struct Body
+	{
+		uint32_t baseline;
+		int bytes;
+		std::vector<uint8_t> data;
+	};
+
+	const WorldMap& world;
+	UdpSocket socket;
+	std::vector<Client> clients;
+	std::unordered_map<uint64_t, int> clientByAddress;
+	SnapshotHistory history;
+	std::vector<Body> bodies;    // <-- one per baseline in use; kept across ticks with their buffers
+	int bodiesUsed = 0;          // <-- how many of them this tick has written
+	std::array<uint8_t, NetPacketBytes> packet;
+
+	static uint64_t Key(const NetAddress& address)
+	{
+		return ((uint64_t)address.address.sin_addr.s_addr << 16) | address.address.sin_port;
+	}
+
+	void ReceiveInputs()
+	{
+		NetAddress from;
+		while (int bytes = socket.Receive(packet.data(), (int)packet.size(), from))
+		{
+			stats.packetsReceived++;
+			stats.bytesReceived += bytes;
+			BitReader reader(packet.data(), bytes);
+			if ((NetMessage)reader.Read(8) != NetMessage::Input)
+			{
+				stats.rejected++;
+				continue;
+			}
+			uint32_t sequence = reader.Read(32);
+			uint32_t acknowledged = reader.Read(32);
+			int8_t forward = (int8_t)reader.Read(8);
+			int8_t strafe = (int8_t)reader.Read(8);
+			uint32_t angle = reader.Read(NetAngleBits);
+			if (reader.overrun)
+			{
+				stats.rejected++;
+				continue;
+			}
+
+			auto [found, added] = clientByAddress.try_emplace(Key(from), (int)clients.size());
+			if (added)
+			{
+				// first word from this address: a new player, somewhere open
+				Client& joined = clients.emplace_back();
+				joined.address = from;
+				FindOpenSpot(world, 0xB0A710u + (uint32_t)found->second * 7919u, joined.x, joined.y);
+			}
+			Client& client = clients[found->second];
+			if (sequence <= client.sequence) continue; // <-- late or duplicate
+			client.sequence = sequence;
+			client.acknowledged = (std::max)(client.acknowledged, acknowledged);
+			client.forward = forward / 127.0f;
+			client.strafe = strafe / 127.0f;
+			DequantizeRotor(angle, client.rotorX, client.rotorY);
+		}
+	}
+
+	const Body& BodyFor(uint32_t baseline, const std::vector<NetPlayerState>& current)
+	{
+		for (int i = 0; i < bodiesUsed; i++)
+		{
+			if (bodies[i].baseline == baseline) return bodies[i];
+		}
+		if (bodiesUsed == (int)bodies.size()) bodies.emplace_back().data.resize(NetPacketBytes - NetSnapshotHeaderBytes);
+		Body& body = bodies[bodiesUsed++];
+		body.baseline = baseline;
+		BitWriter writer(body.data.data(), (int)body.data.size());
+		WriteSnapshotBody(writer, current, history.Find(baseline));
+		body.bytes = writer.Finish();
+		return body;
+	}
+
+	void SendSnapshots(const std::vector<NetPlayerState>& current)
+	{
+		bodiesUsed = 0;
+		for (int slot = 0; slot < (int)clients.size(); slot++)
+		{
+			Client& client = clients[slot];
+			bool usable = client.acknowledged && tick - client.acknowledged < ReplicationHistory && history.Find(client.acknowledged);
+			uint32_t baseline = usable ? client.acknowledged : 0;
+			const Body& body = BodyFor(baseline, current);
+
+			BitWriter header(packet.data(), NetSnapshotHeaderBytes);
+			header.Write((uint32_t)NetMessage::Snapshot, 8);
+			header.Write(tick, 32);
+			header.Write(baseline, 32);
+			header.Write((uint32_t)clients.size(), 16);
+			header.Write((uint32_t)slot, 16);
+			header.Finish();
+			std::memcpy(packet.data() + NetSnapshotHeaderBytes, body.data.data(), body.bytes);
+
+			int bytes = NetSnapshotHeaderBytes + body.bytes;
+			if (!socket.Send(client.address, packet.data(), bytes)) continue;
+			stats.packetsSent++;
+			stats.bytesSent += bytes;
+			(baseline ? stats.deltaSnapshots : stats.fullSnapshots)++;
+		}
+	}
+};
+
+class ReplicationClient
+{
+public:
+	ReplicationStats stats;
+	uint32_t tick = 0;                      // <-- newest snapshot held
+	int slot = -1;                          // <-- this client's player in players
+	std::vector<NetPlayerState> players;    // <-- newest snapshot
+
+	explicit ReplicationClient(const NetAddress& server) : server(server) {}
+
+	// Input for the server's next tick; the rotor is the view, owned by the client.
+	void SendInput(float forward, float strafe, float rotorX, float rotorY)
+	{
+		BitWriter writer(packet.data(), (int)packet.size());
+		writer.Write((uint32_t)NetMessage::Input, 8);
+		writer.Write(++sequence, 32);
+		writer.Write(tick, 32);
+		writer.Write((uint32_t)(int8_t)std::round(std::clamp(forward, -1.0f, 1.0f) * 127.0f), 8);
+		writer.Write((uint32_t)(int8_t)std::round(std::clamp(strafe, -1.0f, 1.0f) * 127.0f), 8);
+		writer.Write(QuantizeRotor(rotorX, rotorY), NetAngleBits);
+		int bytes = writer.Finish();
+		if (!socket.Send(server, packet.data(), bytes)) return;
+		stats.packetsSent++;
+		stats.bytesSent += bytes;
+	}
+
+	// Decodes every waiting snapshot, keeping the newest.
+	void Receive()
+	{
+		NetAddress from;
+		while (int bytes = socket.Receive(packet.data(), (int)packet.size(), from))
+		{
+			stats.packetsReceived++;
+			stats.bytesReceived += bytes;
+			BitReader header(packet.data(), (std::min)(bytes, NetSnapshotHeaderBytes));
+			NetMessage type = (NetMessage)header.Read(8);
+			uint32_t at = header.Read(32);
+			uint32_t baseline = header.Read(32);
+			int count = (int)header.Read(16);
+			int yours = (int)header.Read(16);
+			const std::vector<NetPlayerState>* base = baseline ? history.Find(baseline) : nullptr;
+			bool baseHeld = !baseline || (base && at - baseline < ReplicationHistory);
+			if (header.overrun || type != NetMessage::Snapshot || at <= tick || !baseHeld)
+			{
+				stats.rejected++;
+				continue;
+			}
+
+			std::vector<NetPlayerState>& decoded = history.Slot(at);
+			decoded.resize(count);
+			BitReader body(packet.data() + NetSnapshotHeaderBytes, bytes - NetSnapshotHeaderBytes);
+			if (!ReadSnapshotBody(body, decoded, base))
+			{
+				history.ticks[at & (ReplicationHistory - 1)] = 0;
+				stats.rejected++;
+				continue;
+			}
+			(baseline ? stats.deltaSnapshots : stats.fullSnapshots)++;
+			tick = at;
+			slot = yours;
+			players = decoded;
+		}
+	}
+
+private:
+	NetAddress server;
+	UdpSocket socket;
+	uint32_t sequence = 0;
+	SnapshotHistory history;
+	std::array<uint8_t, NetPacketBytes> packet;
+};
@@ -0,0 +1,53 @@
+#version 450 core
+out vec4 FragColor;
+in vec2 local;
+in vec3 worldpos;
+flat in float depth;
+flat in float brightness;
+layout(std430, binding = 0) readonly buffer Grid
+{
+    float values[512][512];  // height x width, only here for TileAt in LIB.glsl
+};
+layout(std430, binding = 6) readonly buffer ColumnDepth
+{
+	float columnDepth[];	// <-- nearest wall per screen column, perpendicular depth
+};
+uniform vec2 playerpos = vec2(4.5, 4.5); // <-- is the player's position
+uniform float aspectratio = 0.75;
+uniform vec2 resolution = vec2(800.0, 600.0);
+uniform uint frameCount;
+
+/*=============================================================+/
+							Functions
+/+=============================================================*/
+
+int TileAt(ivec2 maploc)
+{
+	return int(values[maploc.y][maploc.x]);
+}
+
+/*=============================================================+/
+							  Main
+/+=============================================================*/
+
+void main()
+{
+	// walls are full height, so the column's depth decides for the whole column
+	int column = min(int(gl_FragCoord.x), columnDepth.length() - 1);
+	if (depth >= columnDepth[column]) discard;
+
+	// round cutout, stretched to the quad
+	if (length(local * 2.0 - 1.0) > 1.0) discard;
+
+	vec3 toPoint = worldpos - vec3(playerpos, playerHeight);
+	float dist2 = dot(toPoint, toPoint);
+
+	vec2 uv = (gl_FragCoord.xy / resolution * 2.0 - 1.0) * vec2(min(1.0, 1.0/aspectratio), min(1.0, aspectratio));
+	float noise = p3DtoFloat(ivec3(vec2AsIvec2(uv), frameCount));
+
+	float kval = brightness * 7.0 / (dist2 + 6.0);
+
+	float tval = pow(noise, 1.0 / kval - 1.0);
+
+	FragColor = vec4(vec3(tval), 1.0);
+}
@@ -0,0 +1,53 @@
+#version 450 core
+struct Sprite
+{
+	vec4 position;		// <-- xyz bottom center, w size
+	float depth;
+	float brightness;
+	vec2 pad;
+};
+layout(std430, binding = 5) readonly buffer Sprites
+{
+	Sprite sprites[];	// <-- sorted far to near by the CPU, one instance each
+};
+out vec2 local;
+out vec3 worldpos;
+flat out float depth;
+flat out float brightness;
+uniform vec2 playerpos = vec2(4.5, 4.5); // <-- is the player's position
+uniform vec2 playerrot = vec2(1.0, 0.0); // <-- is a rotor, player's yaw value as rotor
+uniform float aspectratio = 0.75;
+
+const float playerHeight = 2.0; // <-- is the player's eye height off the ground
+
+const float nearPlane = 0.05;
+const float farPlane = 1000.0;
+
+void main()
+{
+	// two triangles, corners picked by vertex id so no vertex buffer is needed
+	const vec2 corners[6] = vec2[](
+		vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+		vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+	);
+	Sprite sprite = sprites[gl_InstanceID];
+	local = corners[gl_VertexID];
+
+	// same camera basis and projection as WALL.vert; the quad faces the camera, so it lies
+	// in the plane of constant view depth
+	vec3 right = vec3(playerrot.x * playerrot.x - playerrot.y * playerrot.y, -2.0 * playerrot.x * playerrot.y, 0.0);
+	vec3 forward = vec3(-right.y, right.x, 0.0);
+	vec3 up = vec3(0.0, 0.0, 1.0);
+
+	float size = sprite.position.w;
+	vec3 position = sprite.position.xyz + right * (local.x - 0.5) * size + up * local.y * size;
+	vec3 d = position - vec3(playerpos, playerHeight);
+	vec3 view = vec3(dot(d, right), dot(d, up), dot(d, forward));
+	vec2 scale = vec2(min(1.0, 1.0/aspectratio), min(1.0, aspectratio)); // <-- matches FSQ.vert
+
+	float z = (view.z * (farPlane + nearPlane) - 2.0 * farPlane * nearPlane) / (farPlane - nearPlane);
+	gl_Position = vec4(view.xy / scale, z, view.z);
+	worldpos = position;
+	depth = sprite.depth;
+	brightness = sprite.brightness;
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <algorithm>
+
+#include "Grid.h"
+#include "Entities.h"
+
+/*=============================================================================+/
+								   Snapshots
+/+=============================================================================*/
+
+/*
+	Save states cheap enough to take every tick, for rollback and quick save.
+	The map is a megabyte that almost never changes, so it is snapshotted copy on write in
+	4 KB pages (two map rows each):
+		- the live bytes stay where they are (mapdata is read everywhere); writers Touch what
+		  they change, which marks those pages dirty
+		- the region keeps the immutable pages the live bytes last matched; Capture copies only
+		  the dirty pages into fresh ones, and a snapshot is that page table with a reference
+		  on every page, so snapshots share every page that didn't change between them
+		- Restore copies back only the pages that differ from the live state, by pointer
+	Pages are reference counted and recycled through a free list, so once the pool has grown
+	to its high water mark, snapshotting never touches the heap. Single threaded: capture and
+	restore on the thread that owns the live bytes.
+	The player and entities change every tick anyway, so they are plain copies into the
+	snapshot's own arrays, whose capacity is reused.
+*/
+
+constexpr size_t SnapshotPageBytes = 4096;
+
+struct SnapshotPage
+{
+	uint32_t references = 0;
+	SnapshotPage* nextFree = nullptr;
+	alignas(64) std::byte bytes[SnapshotPageBytes];
+};
+
+class CowRegion;
+
+// One capture of a CowRegion. Clear it (or let it go) before the region goes away.
+class RegionSnapshot
+{
+public:
+	RegionSnapshot() = default;
+	~RegionSnapshot() { Clear(); }
+	RegionSnapshot(const RegionSnapshot&) = delete;
+	RegionSnapshot& operator=(const RegionSnapshot&) = delete;
+
+	bool Empty() const { return region == nullptr; }
+	inline void Clear();
+
+private:
+	friend class CowRegion;
+	CowRegion* region = nullptr;
+	std::vector<SnapshotPage*> pages;
+};
+
+class CowRegion
+{
+public:
+	// stats
+	int capturedPages = 0;    // <-- pages copied by the last Capture
+	std::vector<int> restored; // <-- pages copied by the last Restore, to redo what depends on them
+
+	CowRegion(void* live, size_t bytes) : live(static_cast<std::byte*>(live)), bytes(bytes)
+	{
+		current.assign(PageCount(), nullptr);
+		dirty.assign((PageCount() + 63) / 64, 0);
+		TouchAll(); // <-- nothing captured yet
+	}
+	~CowRegion() { for (SnapshotPage* page : current) Release(page); }
+	CowRegion(const CowRegion&) = delete;
+	CowRegion& operator=(const CowRegion&) = delete;
+
+	int PageCount() const { return (int)((bytes + SnapshotPageBytes - 1) / SnapshotPageBytes); }
+
+	// Pages allocated so far, free or in use.
+	int PoolPages() const { return (int)pool.size(); }
+
+	// The live bytes in [offset, offset + count) changed, or will before the next Capture.
+	void Touch(size_t offset, size_t count)
+	{
+		if (count == 0) return;
+		size_t first = offset / SnapshotPageBytes;
+		size_t last = (offset + count - 1) / SnapshotPageBytes;
+		for (size_t page = first; page <= last; page++) dirty[page >> 6] |= 1ull << (page & 63);
+	}
+
+	void TouchAll() { Touch(0, bytes); }
+
+	void Capture(RegionSnapshot& into)
+	{
+		capturedPages = 0;
+		for (size_t word = 0; word < dirty.size(); word++)
+		{
+			for (uint64_t bits = dirty[word]; bits; bits &= bits - 1)
+			{
+				size_t page = word * 64 + std::countr_zero(bits);
+				SnapshotPage* copy = Allocate();
+				std::memcpy(copy->bytes, live + page * SnapshotPageBytes, PageBytes(page));
+				Release(current[page]);
+				current[page] = copy;
+				capturedPages++;
+			}
+			dirty[word] = 0;
+		}
+
+		if (into.region != this)
+		{
+			into.Clear();
+			into.region = this;
+			into.pages.assign(current.size(), nullptr);
+		}
+		for (size_t page = 0; page < current.size(); page++)
+		{
+			if (into.pages[page] == current[page]) continue;
+			Release(into.pages[page]);
+			into.pages[page] = current[page];
+			into.pages[page]->references++;
+		}
+	}
+
+	// Puts the live bytes back as they were at from, returns the pages copied.
+	int Restore(const RegionSnapshot& from)
+	{
+		restored.clear();
+		if (from.region != this) return 0;
+		for (size_t page = 0; page < current.size(); page++)
+		{
+			bool isDirty = (dirty[page >> 6] >> (page & 63)) & 1;
+			if (!isDirty && current[page] == from.pages[page]) continue;
+			std::memcpy(live + page * SnapshotPageBytes, from.pages[page]->bytes, PageBytes(page));
+			from.pages[page]->references++;
+			Release(current[page]);
+			current[page] = from.pages[page];
+			dirty[page >> 6] &= ~(1ull << (page & 63));
+			restored.push_back((int)page);
+		}
+		return (int)restored.size();
+	}
+
+private:
+	friend class RegionSnapshot;
+	std::byte* live;
+	size_t bytes;
+	std::vector<SnapshotPage*> current;   // <-- what the live bytes equal, except on dirty pages
+	std::vector<uint64_t> dirty;
+	std::vector<std::unique_ptr<SnapshotPage>> pool;
+	SnapshotPage* freePages = nullptr;
+
+	size_t PageBytes(size_t page) const { return (std::min)(SnapshotPageBytes, bytes - page * SnapshotPageBytes); }
+
+	SnapshotPage* Allocate()
+	{
+		if (!freePages)
+		{
+			pool.push_back(std::make_unique<SnapshotPage>());
+			freePages = pool.back().get();
+		}
+		SnapshotPage* page = freePages;
+		freePages = page->nextFree;
+		page->references = 1;
+		return page;
+	}
+
+	void Release(SnapshotPage* page)
+	{
+		if (!page || --page->references > 0) return;
+		page->nextFree = freePages;
+		freePages = page;
+	}
+};
+
+inline void RegionSnapshot::Clear()
+{
+	if (!region) return;
+	for (SnapshotPage* page : pages) region->Release(page);
+	pages.clear();
+	region = nullptr;
+}
+
+// Marks the tiles [x0, x1) x [y0, y1) of a TileMap region as changed.
+inline void TouchTiles(CowRegion& map, int x0, int y0, int x1, int y1)
+{
+	for (int y = y0; y < y1; y++) map.Touch(((size_t)y * MapSize + x0) * sizeof(float), (size_t)(x1 - x0) * sizeof(float));
+}
+
+// Everything a save state holds: the map pages, the player, and the entities if any.
+struct WorldSnapshot
+{
+	RegionSnapshot map;
+	std::array<double, 2> playerPosition{};
+	std::array<double, 2> playerRotor{};
+	std::vector<float> entityX, entityY;
+	std::vector<float> entityVX, entityVY;
+	std::vector<float> entityRadius;
+
+	void Capture(CowRegion& mapPages, const std::array<double, 2>& position, const std::array<double, 2>& rotor, const EntitySystem* entities)
+	{
+		mapPages.Capture(map);
+		playerPosition = position;
+		playerRotor = rotor;
+		if (!entities) return;
+		entityX = entities->posX;
+		entityY = entities->posY;
+		entityVX = entities->velX;
+		entityVY = entities->velY;
+		entityRadius = entities->radius;
+	}
+
+	// Returns the map pages that had to be copied back.
+	int Restore(CowRegion& mapPages, std::array<double, 2>& position, std::array<double, 2>& rotor, EntitySystem* entities) const
+	{
+		position = playerPosition;
+		rotor = playerRotor;
+		if (entities)
+		{
+			entities->posX = entityX;
+			entities->posY = entityY;
+			entities->velX = entityVX;
+			entities->velY = entityVY;
+			entities->radius = entityRadius;
+		}
+		return mapPages.Restore(map);
+	}
+};
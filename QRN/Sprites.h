@@ -0,0 +1,231 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <bit>
+#include <span>
+
+#include "Grid.h"
+#include "Hash.h"
+#include "Mesher.h"
+#include "FrameMemory.h"
+#include "Parallel.h"
+
+/*=============================================================================+/
+									Sprites
+/+=============================================================================*/
+
+/*
+	Camera facing billboards (NPCs, items) drawn over any render mode. Walls are full height,
+	so one depth per screen column says everything about what they hide: a column's ray is
+	cast with the same camera basis as RDR.frag and its perpendicular depth kept. That buffer
+	does double duty:
+		1. on the CPU, sprites outside the view cone, past the far depth, or behind the walls
+		   of every column they cover are dropped before anything is uploaded
+		2. on the GPU, SPRITE.frag discards fragments behind their column's wall
+	Survivors are radix sorted far to near on their depth bits, so nearer sprites paint over
+	farther ones without a depth buffer (the fragment and compute paths have none), and go
+	out as one instanced draw from one buffer.
+*/
+
+constexpr int MaxSprites = 65536;
+constexpr int MaxSpriteColumns = 8192;       // <-- widest framebuffer the column buffer is allocated for
+constexpr float SpriteNear = 0.05f;          // <-- matches nearPlane in WALL.vert / SPRITE.vert
+constexpr float SpriteFar = 96.0f;           // <-- dither noise swallows anything further away
+
+struct Sprite
+{
+	float x, y;
+	float z;          // <-- height of the bottom edge off the floor
+	float size;       // <-- width and height, the sprite stays between floor and ceiling
+	float brightness;
+};
+
+// One instance as SPRITE.vert reads it, std430 layout.
+struct GpuSprite
+{
+	float position[4]; // <-- xyz bottom center, w size
+	float depth;       // <-- view space depth, compared against the column buffer
+	float brightness;
+	float pad[2];
+};
+static_assert(sizeof(GpuSprite) == 32, "GpuSprite must match the std430 layout in SPRITE.vert");
+
+// The player's view in the terms both the column pass and the culling need.
+struct SpriteCamera
+{
+	float x, y;
+	float forwardX, forwardY;
+	float rightX, rightY;
+	float scaleX;     // <-- min(1, 1 / aspect), as in FSQ.vert
+	int columns;      // <-- framebuffer width
+};
+
+inline SpriteCamera MakeSpriteCamera(float x, float y, float rotorX, float rotorY, float aspect, int columns)
+{
+	SpriteCamera camera;
+	camera.x = x;
+	camera.y = y;
+	camera.rightX = rotorX * rotorX - rotorY * rotorY;
+	camera.rightY = -2.0f * rotorX * rotorY;
+	camera.forwardX = -camera.rightY;
+	camera.forwardY = camera.rightX;
+	camera.scaleX = (std::min)(1.0f, 1.0f / aspect);
+	camera.columns = (std::min)(columns, MaxSpriteColumns);
+	return camera;
+}
+
+struct SpriteRenderer
+{
+	std::vector<float> columnDepth;       // <-- perpendicular wall depth per screen column
+	std::vector<GpuSprite> visible;       // <-- sorted instances, ready to upload
+
+	std::vector<GpuSprite> candidates;    // <-- survivors of Cull, in sprite order
+
+	// stats from the last Prepare
+	int culledCone = 0;
+	int culledDepth = 0;
+	int culledOccluded = 0;
+	double columnsMs = 0.0;
+	double cullMs = 0.0;
+	double sortMs = 0.0;
+
+	int Count() const { return (int)visible.size(); }
+
+	// Column depths, cull, sort. Fills visible.
+	void Prepare(const OccupancyBits& bits, const SpriteCamera& camera, const std::vector<Sprite>& sprites)
+	{
+		auto start = std::chrono::steady_clock::now();
+		ColumnDepths(bits, camera);
+		auto columnsDone = std::chrono::steady_clock::now();
+		Cull(camera, sprites);
+		auto culled = std::chrono::steady_clock::now();
+		Sort();
+		auto sorted = std::chrono::steady_clock::now();
+		columnsMs = std::chrono::duration<double, std::milli>(columnsDone - start).count();
+		cullMs = std::chrono::duration<double, std::milli>(culled - columnsDone).count();
+		sortMs = std::chrono::duration<double, std::milli>(sorted - culled).count();
+	}
+
+	// One 2D ray through the center of every pixel column. TraceRay measures along the unit
+	// direction; dividing by the length of the unnormalized one (forward component 1) turns
+	// that into the depth the vertex shader puts in w.
+	void ColumnDepths(const OccupancyBits& bits, const SpriteCamera& camera)
+	{
+		int columns = camera.columns;
+		columnDepth.resize(columns);
+		constexpr int ColumnBlock = 64;
+		ParallelFor(0, (columns + ColumnBlock - 1) / ColumnBlock, [&](int block)
+		{
+			int end = (std::min)((block + 1) * ColumnBlock, columns);
+			for (int c = block * ColumnBlock; c < end; c++)
+			{
+				float u = ((c + 0.5f) / columns * 2.0f - 1.0f) * camera.scaleX;
+				float dx = camera.forwardX + camera.rightX * u;
+				float dy = camera.forwardY + camera.rightY * u;
+				float length = std::sqrt(dx * dx + dy * dy);
+				float t = TraceRay(bits, camera.x, camera.y, dx / length, dy / length, SpriteFar * length);
+				columnDepth[c] = t / length;
+			}
+		});
+	}
+
+	void Cull(const SpriteCamera& camera, const std::vector<Sprite>& sprites)
+	{
+		culledCone = culledDepth = culledOccluded = 0;
+		candidates.clear();
+		candidates.reserve(sprites.size()); // <-- every sprite could survive; reserved once, not per frame
+		visible.reserve(sprites.size());
+		int columns = (int)columnDepth.size();
+		for (const Sprite& sprite : sprites)
+		{
+			float dx = sprite.x - camera.x;
+			float dy = sprite.y - camera.y;
+			float depth = dx * camera.forwardX + dy * camera.forwardY;
+			if (depth < SpriteNear || depth > SpriteFar) { culledDepth++; continue; }
+
+			// horizontal extent in NDC; vertically the sprite always spans some of the view
+			float across = (dx * camera.rightX + dy * camera.rightY) / (depth * camera.scaleX);
+			float half = 0.5f * sprite.size / (depth * camera.scaleX);
+			if (across + half < -1.0f || across - half > 1.0f) { culledCone++; continue; }
+
+			// pixel columns the quad covers; hidden only if every one of them has a nearer wall
+			int first = (std::max)((int)std::floor((across - half + 1.0f) * 0.5f * columns), 0);
+			int last = (std::min)((int)std::floor((across + half + 1.0f) * 0.5f * columns), columns - 1);
+			bool seen = false;
+			for (int c = first; c <= last && !seen; c++) seen = columnDepth[c] > depth;
+			if (!seen) { culledOccluded++; continue; }
+
+			GpuSprite instance;
+			instance.position[0] = sprite.x;
+			instance.position[1] = sprite.y;
+			instance.position[2] = sprite.z;
+			instance.position[3] = sprite.size;
+			instance.depth = depth;
+			instance.brightness = sprite.brightness;
+			instance.pad[0] = instance.pad[1] = 0.0f;
+			candidates.push_back(instance);
+		}
+	}
+
+	// LSD radix sort, 4 passes of 8 bits. Depths are positive, so their bit patterns order
+	// like the floats; inverting them puts the farthest first. Scratch is frame memory.
+	void Sort()
+	{
+		int count = (int)candidates.size();
+		ArenaScope scope;
+		std::span<uint32_t> keys = FrameMemory().Array<uint32_t>(count);
+		std::span<uint32_t> order = FrameMemory().Array<uint32_t>(count);
+		std::span<uint32_t> keyScratch = FrameMemory().Array<uint32_t>(count);
+		std::span<uint32_t> orderScratch = FrameMemory().Array<uint32_t>(count);
+		for (int i = 0; i < count; i++)
+		{
+			keys[i] = ~std::bit_cast<uint32_t>(candidates[i].depth);
+			order[i] = (uint32_t)i;
+		}
+
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			uint32_t offsets[256] = {};
+			for (int i = 0; i < count; i++) offsets[(keys[i] >> shift) & 0xFFu]++;
+			uint32_t sum = 0;
+			for (uint32_t& offset : offsets)
+			{
+				uint32_t n = offset;
+				offset = sum;
+				sum += n;
+			}
+			for (int i = 0; i < count; i++)
+			{
+				uint32_t slot = offsets[(keys[i] >> shift) & 0xFFu]++;
+				keyScratch[slot] = keys[i];
+				orderScratch[slot] = order[i];
+			}
+			std::swap(keys, keyScratch);
+			std::swap(order, orderScratch);
+		}
+
+		visible.resize(count);
+		for (int i = 0; i < count; i++) visible[i] = candidates[order[i]];
+	}
+};
+
+// count sprites on random open tiles, a mix of small items on the floor and person sized ones.
+inline std::vector<Sprite> SpawnSprites(const OccupancyBits& bits, int count, uint32_t seed)
+{
+	std::vector<Sprite> sprites;
+	for (uint32_t attempt = 0; (int)sprites.size() < count && attempt < (uint32_t)count * 16u; attempt++)
+	{
+		uint32_t h = ChaoticHash(seed + attempt * 0x9E3779B9u);
+		float x = UintToUnit(h) * (float)MapSize;
+		float y = UintToUnit(ChaoticHash(h)) * (float)MapSize;
+		if (IsOccupied(bits, (int)x, (int)y)) continue;
+		bool item = UintToUnit(ChaoticHash(h + 1u)) < 0.5f;
+		float size = item ? 0.4f : 1.2f + 0.8f * UintToUnit(ChaoticHash(h + 2u));
+		float brightness = 0.4f + 0.6f * UintToUnit(ChaoticHash(h + 3u));
+		sprites.push_back({ x, y, 0.0f, (std::min)(size, CeilingHeight), brightness });
+	}
+	return sprites;
+}
@@ -0,0 +1,44 @@
+#version 450 core
+out vec4 FragColor;
+in vec3 worldpos;
+flat in vec3 facenormal;
+layout(std430, binding = 0) buffer Grid
+{
+    float values[512][512];  // height x width
+};
+uniform vec2 playerpos = vec2(4.5, 4.5); // <-- is the player's position
+uniform float aspectratio = 0.75;
+uniform vec2 resolution = vec2(800.0, 600.0);
+uniform uint frameCount;
+
+/*=============================================================+/
+							Functions
+/+=============================================================*/
+
+int TileAt(ivec2 maploc)
+{
+	return int(values[maploc.y][maploc.x]);
+}
+
+/*=============================================================+/
+							  Main
+/+=============================================================*/
+
+void main()
+{
+	vec3 ro = vec3(playerpos, playerHeight);
+	vec3 toPoint = worldpos - ro;
+
+	// the face's own tile sits half a unit behind it, against the normal
+	ivec2 tileid = ivec2(floor(worldpos.xy - facenormal.xy * 0.5));
+	HitInfo hit = FaceHit(ro, normalize(toPoint), length(toPoint), abs(facenormal), tileid);
+
+	vec2 uv = (gl_FragCoord.xy / resolution * 2.0 - 1.0) * vec2(min(1.0, 1.0/aspectratio), min(1.0, aspectratio));
+	float noise = p3DtoFloat(ivec3(vec2AsIvec2(uv), frameCount));
+
+	float kval = getValue(hit);
+
+	float tval = pow(noise, 1.0 / kval - 1.0);
+
+	FragColor = vec4(vec3(tval), 1.0);
+}
@@ -0,0 +1,30 @@
+#version 450 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+out vec3 worldpos;
+flat out vec3 facenormal;
+uniform vec2 playerpos = vec2(4.5, 4.5); // <-- is the player's position
+uniform vec2 playerrot = vec2(1.0, 0.0); // <-- is a rotor, player's yaw value as rotor
+uniform float aspectratio = 0.75;
+
+const float playerHeight = 2.0; // <-- is the player's eye height off the ground
+
+const float nearPlane = 0.05;
+const float farPlane = 1000.0; // <-- DDACheck clamps floor / ceiling distance to this
+
+void main()
+{
+	// same camera basis as RDR.frag, projected so a point lands on the pixel whose ray hits it
+	vec3 right = vec3(playerrot.x * playerrot.x - playerrot.y * playerrot.y, -2.0 * playerrot.x * playerrot.y, 0.0);
+	vec3 forward = vec3(-right.y, right.x, 0.0);
+	vec3 up = vec3(0.0, 0.0, 1.0);
+
+	vec3 d = position - vec3(playerpos, playerHeight);
+	vec3 view = vec3(dot(d, right), dot(d, up), dot(d, forward));
+	vec2 scale = vec2(min(1.0, 1.0/aspectratio), min(1.0, aspectratio)); // <-- matches FSQ.vert
+
+	float depth = (view.z * (farPlane + nearPlane) - 2.0 * farPlane * nearPlane) / (farPlane - nearPlane);
+	gl_Position = vec4(view.xy / scale, depth, view.z);
+	worldpos = position;
+	facenormal = normal;
+}
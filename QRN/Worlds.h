@@ -0,0 +1,285 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include "Grid.h"
+#include "Hash.h"
+#include "DistanceField.h"
+#include "Collision.h"
+#include "Parallel.h"
+
+/*=============================================================================+/
+									Worlds
+/+=============================================================================*/
+
+/*
+	Thousands of independent QRN worlds in one process with no window or GL, for agents and
+	soak tests against the movement and collision rules.
+		- maps are shared: a world refers to one by index, so a thousand worlds on 16 maps
+		  hold 16 occupancy grids and distance fields (about a megabyte each), not a thousand
+		- per world state (player, inputs, counters) is structure of arrays over worlds, and
+		  the entities of every world share one set of arrays, world w owning a contiguous
+		  range of them
+		- a tick follows the interactive rules: walking and turning as in QRN.cpp's onUpdate,
+		  ResolveCircle against the distance field, entities bouncing off walls as in
+		  EntitySystem and pushing each other (and the player) apart within their world
+		- worlds step in blocks on the job system, each world on one thread in a fixed order,
+		  so results don't depend on how many threads there are
+*/
+
+constexpr int WorldBlock = 16;                 // <-- worlds per parallel task
+constexpr float WorldPlayerRadius = 0.95f;     // <-- playerRadius in QRN.cpp
+constexpr float WorldPlayerSpeed = 4.0f;       // <-- movementSpeed in QRN.cpp
+constexpr float WorldEntityRadius = 0.3f;
+
+// Walled border plus random 3x3 wall blocks covering roughly density of the map.
+inline OccupancyBits NoiseMap(float density, uint32_t seed)
+{
+	OccupancyBits bits{};
+	std::array<uint32_t, MapSize> noise;
+	for (int y = 0; y < MapSize; y++)
+	{
+		// P3DtoFloat(x / 3, y / 3, seed) for the whole row: the y and seed part is shared,
+		// the last two hashes go through the batch kernel
+		uint32_t row = ChaoticHash((uint32_t)(y / 3) + ChaoticHash(seed));
+		for (int x = 0; x < MapSize; x++) noise[x] = (uint32_t)(x / 3) + row;
+		HashBatch(noise.data(), noise.data(), MapSize);
+		HashBatch(noise.data(), noise.data(), MapSize);
+		for (int x = 0; x < MapSize; x++)
+		{
+			bool border = x == 0 || y == 0 || x == MapSize - 1 || y == MapSize - 1;
+			if (border || UintToUnit(noise[x]) < density) bits[y * OccupancyRowWords + (x >> 5)] |= 1u << (x & 31);
+		}
+	}
+	return bits;
+}
+
+struct WorldMap
+{
+	OccupancyBits bits;
+	DistanceField field;
+};
+
+// A random spot with room for a player, seeded so it is repeatable.
+inline void FindOpenSpot(const WorldMap& world, uint32_t seed, float& x, float& y)
+{
+	for (uint32_t attempt = 0; attempt < 4096; attempt++)
+	{
+		uint32_t h = ChaoticHash(seed + attempt * 0x9E3779B9u);
+		x = 1.0f + UintToUnit(h) * (float)(MapSize - 2);
+		y = 1.0f + UintToUnit(ChaoticHash(h)) * (float)(MapSize - 2);
+		if (world.field.Clearance((int)x, (int)y) >= WorldPlayerRadius) break;
+	}
+}
+
+// One tick of walking as onUpdate does it: forward and strafe (each -1 to 1) along the
+// rotor's heading at WorldPlayerSpeed, then out of any wall. Returns whether it hit one.
+inline bool WalkPlayer(const WorldMap& world, float& px, float& py, float rotorX, float rotorY, float forward, float strafe, float dt)
+{
+	float forwardX = 2.0f * rotorX * rotorY;
+	float forwardY = rotorX * rotorX - rotorY * rotorY;
+	float moveX = strafe * forwardY + forward * forwardX;
+	float moveY = -strafe * forwardX + forward * forwardY;
+	float moveLength = std::sqrt(moveX * moveX + moveY * moveY);
+	if (moveLength > 0.0f)
+	{
+		px += moveX / moveLength * WorldPlayerSpeed * dt;
+		py += moveY / moveLength * WorldPlayerSpeed * dt;
+	}
+	if (world.field.Clearance((int)std::floor(px), (int)std::floor(py)) >= WorldPlayerRadius) return false;
+	return ResolveCircleTiles(world.bits, px, py, WorldPlayerRadius);
+}
+
+struct WorldBatch
+{
+	std::vector<std::unique_ptr<WorldMap>> maps;
+
+	// per world
+	std::vector<int> map;
+	std::vector<float> playerX, playerY;
+	std::vector<float> rotorX, rotorY;             // <-- yaw as a rotor, like playerrotraw
+	std::vector<float> moveForward, moveStrafe;    // <-- input for the next tick, each -1 to 1
+	std::vector<float> turn;                       // <-- input, radians per second, positive turns left
+	std::vector<uint32_t> wallTicks;               // <-- ticks the player touched a wall
+	std::vector<uint32_t> entityTicks;             // <-- ticks the player touched an entity
+	std::vector<int> entityStart;                  // <-- world w owns [entityStart[w], entityStart[w + 1])
+
+	// entities of every world
+	std::vector<float> entityX, entityY;
+	std::vector<float> entityVX, entityVY;
+	std::vector<float> entityRadius;
+
+	uint64_t ticks = 0;
+	double lastStepMs = 0.0;
+
+	WorldBatch() { entityStart.push_back(0); }
+
+	int WorldCount() const { return (int)map.size(); }
+	int EntityCount() const { return (int)entityX.size(); }
+	int MapCount() const { return (int)maps.size(); }
+
+	int AddMap(float density, uint32_t seed)
+	{
+		auto added = std::make_unique<WorldMap>();
+		added->bits = NoiseMap(density, seed);
+		added->field.Generate(added->bits);
+		maps.push_back(std::move(added));
+		return MapCount() - 1;
+	}
+
+	// A world on an existing map, the player and its entities at random open spots.
+	int AddWorld(int mapIndex, int entities, uint32_t seed)
+	{
+		const WorldMap& world = *maps[mapIndex];
+		float x, y;
+		FindOpenSpot(world, seed, x, y);
+		map.push_back(mapIndex);
+		playerX.push_back(x);
+		playerY.push_back(y);
+		rotorX.push_back(1.0f);
+		rotorY.push_back(0.0f);
+		moveForward.push_back(0.0f);
+		moveStrafe.push_back(0.0f);
+		turn.push_back(0.0f);
+		wallTicks.push_back(0);
+		entityTicks.push_back(0);
+
+		for (uint32_t attempt = 0, spawned = 0; spawned < (uint32_t)entities && attempt < (uint32_t)entities * 16u; attempt++)
+		{
+			uint32_t h = ChaoticHash(~seed + attempt * 0x9E3779B9u);
+			float ex = UintToUnit(h) * (float)MapSize;
+			float ey = UintToUnit(ChaoticHash(h)) * (float)MapSize;
+			if (IsOccupied(world.bits, (int)ex, (int)ey)) continue;
+			float angle = UintToUnit(ChaoticHash(h ^ 0x5bd1e995u)) * 6.2831853f;
+			float speed = 1.0f + 3.0f * UintToUnit(ChaoticHash(h + 1u));
+			ResolveCircleTiles(world.bits, ex, ey, WorldEntityRadius);
+			entityX.push_back(ex);
+			entityY.push_back(ey);
+			entityVX.push_back(std::cos(angle) * speed);
+			entityVY.push_back(std::sin(angle) * speed);
+			entityRadius.push_back(WorldEntityRadius);
+			spawned++;
+		}
+		entityStart.push_back(EntityCount());
+		return WorldCount() - 1;
+	}
+
+	// One fixed tick of every world.
+	void Step(float dt)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int worlds = WorldCount();
+		ParallelFor(0, (worlds + WorldBlock - 1) / WorldBlock, [&](int block)
+		{
+			int end = (std::min)((block + 1) * WorldBlock, worlds);
+			for (int w = block * WorldBlock; w < end; w++) StepWorld(w, dt);
+		});
+		ticks++;
+		lastStepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// What the worlds hold, shared maps included.
+	size_t MemoryBytes() const
+	{
+		size_t bytes = maps.size() * (sizeof(WorldMap) + (size_t)MapSize * MapSize * sizeof(float));
+		bytes += (size_t)WorldCount() * (sizeof(int) * 2 + sizeof(float) * 7 + sizeof(uint32_t) * 2);
+		bytes += (size_t)EntityCount() * sizeof(float) * 5;
+		return bytes;
+	}
+
+	// Worlds whose player ended up inside a wall tile; a soak test wants zero.
+	int PlayersInWalls() const
+	{
+		int inside = 0;
+		for (int w = 0; w < WorldCount(); w++) inside += IsOccupied(maps[map[w]]->bits, (int)std::floor(playerX[w]), (int)std::floor(playerY[w]));
+		return inside;
+	}
+
+private:
+	void StepWorld(int w, float dt)
+	{
+		const WorldMap& world = *maps[map[w]];
+
+		// turn, then walk along the new heading, as the mouse and WASD do
+		float half = -0.5f * turn[w] * dt; // <-- a rotor turns by minus twice its angle
+		float c = std::cos(half), s = std::sin(half);
+		float rx = c * rotorX[w] - s * rotorY[w];
+		float ry = c * rotorY[w] + s * rotorX[w];
+		float length = std::sqrt(rx * rx + ry * ry);
+		rotorX[w] = rx / length;
+		rotorY[w] = ry / length;
+
+		wallTicks[w] += WalkPlayer(world, playerX[w], playerY[w], rotorX[w], rotorY[w], moveForward[w], moveStrafe[w], dt);
+		float px = playerX[w];
+		float py = playerY[w];
+
+		int first = entityStart[w], last = entityStart[w + 1];
+		for (int i = first; i < last; i++)
+		{
+			entityX[i] += entityVX[i] * dt;
+			entityY[i] += entityVY[i] * dt;
+		}
+
+		// pairs within this world, applied as found; fine for the handful each world has
+		bool touchedPlayer = false;
+		for (int i = first; i < last; i++)
+		{
+			for (int j = i + 1; j < last; j++)
+			{
+				float dx = entityX[i] - entityX[j];
+				float dy = entityY[i] - entityY[j];
+				float reach = entityRadius[i] + entityRadius[j];
+				float dist2 = dx * dx + dy * dy;
+				if (dist2 >= reach * reach) continue;
+				float dist = std::sqrt(dist2);
+				float overlap = 0.5f * (reach - dist);
+				float nx = dist > 0.0f ? dx / dist : 1.0f;
+				float ny = dist > 0.0f ? dy / dist : 0.0f;
+				entityX[i] += nx * overlap; entityY[i] += ny * overlap;
+				entityX[j] -= nx * overlap; entityY[j] -= ny * overlap;
+			}
+
+			// the player doesn't budge, the entity takes the whole push
+			float dx = entityX[i] - px;
+			float dy = entityY[i] - py;
+			float reach = entityRadius[i] + WorldPlayerRadius;
+			float dist2 = dx * dx + dy * dy;
+			if (dist2 < reach * reach)
+			{
+				float dist = std::sqrt(dist2);
+				float nx = dist > 0.0f ? dx / dist : 1.0f;
+				float ny = dist > 0.0f ? dy / dist : 0.0f;
+				entityX[i] = px + nx * reach;
+				entityY[i] = py + ny * reach;
+				touchedPlayer = true;
+			}
+		}
+		entityTicks[w] += touchedPlayer;
+
+		// walls last, so nothing is left inside one
+		for (int i = first; i < last; i++)
+		{
+			if (world.field.Clearance((int)std::floor(entityX[i]), (int)std::floor(entityY[i])) >= entityRadius[i]) continue;
+			BounceCircle(world.bits, entityX[i], entityY[i], entityVX[i], entityVY[i], entityRadius[i]);
+		}
+	}
+};
+
+// Stand in agents for soak tests: every world wanders, holding each random input for half
+// a second. Depends only on the world and the tick, so runs are repeatable.
+inline void DriveRandomAgents(WorldBatch& batch, float dt)
+{
+	uint32_t period = (uint32_t)(batch.ticks * dt * 2.0f);
+	for (int w = 0; w < batch.WorldCount(); w++)
+	{
+		uint32_t h = ChaoticHash((uint32_t)w * 0x9E3779B9u + period);
+		batch.moveForward[w] = UintToUnit(h) * 2.0f - 0.5f;   // <-- mostly forward
+		batch.moveStrafe[w] = UintToUnit(ChaoticHash(h)) * 2.0f - 1.0f;
+		batch.turn[w] = (UintToUnit(ChaoticHash(h + 1u)) * 2.0f - 1.0f) * 3.0f;
+	}
+}
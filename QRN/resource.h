@@ -5,12 +5,20 @@
 #define IDR_RCDATA1                     101
 #define IDR_RCDATA2                     102
 #define IDR_RCDATA3                     103
+#define IDR_RCDATA4                     104
+#define IDR_RCDATA5                     105
+#define IDR_RCDATA6                     106
+#define IDR_RCDATA7                     107
+#define IDR_RCDATA8                     108
+#define IDR_RCDATA9                     109
+#define IDR_RCDATA10                    110
+#define IDR_RCDATA11                    111
 
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        105
+#define _APS_NEXT_RESOURCE_VALUE        112
 #define _APS_NEXT_COMMAND_VALUE         40001
 #define _APS_NEXT_CONTROL_VALUE         1001
 #define _APS_NEXT_SYMED_VALUE           101